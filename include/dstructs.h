@@ -36,20 +36,98 @@ typedef struct __llist_s llist_t;
 typedef struct __ll_iter_s ll_itr_t;
 
 
+/**
+ * Linkedlist node pool public, opaque data type. Contents only accessable
+ * through function calls.
+ **/
+typedef struct __ll_pool_s ll_pool_t;
+
+
+/**
+ * Linkedlist cursor. Unlike ll_itr_t, a cursor is owned by the caller and may
+ * be allocated on the stack; ll_cur(...) positions it. Its members are not
+ * intended for use by the user. A cursor is invalidated when an element
+ * next to it is removed from the list.
+ **/
+typedef struct __ll_cur_s {
+   void *__next;
+   void *__prev;
+   int __nslot;
+   int __pslot;
+} ll_cur_t;
+
+
 /* Wrapper macro for __ll_init(size_t __alloc_size) */
 #define ll_init(type) (__ll_init(sizeof(type)))
 
+/**
+ * Wrapper macro for __ll_init_unrolled(size_t __elem_size, int per_node). An
+ * unrolled list keeps up to per_node elements in each node; 0 picks as many
+ * as fill two cache lines.
+ **/
+#define ll_init_unrolled(type, per_node) \
+   (__ll_init_unrolled(sizeof(type), (per_node)))
+
+/**
+ * Wrapper macro for __ll_init_indexed(size_t __elem_size). An indexed list
+ * keeps a skip list over its nodes, making positional access O(log n).
+ **/
+#define ll_init_indexed(type) (__ll_init_indexed(sizeof(type)))
+
+/**
+ * Wrapper macro for __ll_init_inline(size_t __elem_size). An inline list
+ * copies its elements into its nodes; see ll_rem_into(...) to copy them out.
+ **/
+#define ll_init_inline(type) (__ll_init_inline(sizeof(type)))
+
+/**
+ * Wrapper macro for __ll_init_unrolled_inline(size_t __elem_size,
+ * int per_node). An unrolled list whose nodes hold the elements themselves;
+ * a pointer to an element is valid only until the list is next modified.
+ **/
+#define ll_init_unrolled_inline(type, per_node) \
+   (__ll_init_unrolled_inline(sizeof(type), (per_node)))
+
 /* Semantic macro for determining if a list is empty */
 #define ll_empty(L) (!ll_first(L))
 
+/**
+ * Built-in orderings for ll_sort(...). Elements are compared by their bytes,
+ * as signed integers, or as unsigned integers, respectively. Integer
+ * orderings apply to elements of 1, 2, 4 or 8 bytes.
+ **/
+#define LL_CMP_MEM  ((int (*)(const void*, const void*)) 0)
+#define LL_CMP_INT  ((int (*)(const void*, const void*)) 1)
+#define LL_CMP_UINT ((int (*)(const void*, const void*)) 2)
+
+/* Semantic macros for determining if a cursor has more elements */
+#define lc_hasnext(C) ((C)->__next != NULL)
+#define lc_hasprev(C) ((C)->__prev != NULL)
+
+/**
+ * Loop over every element of a list, in order, without allocating. E is
+ * assigned each element in turn and C is the ll_cur_t used to walk the list.
+ **/
+#define ll_foreach(L, E, C) \
+   for(ll_cur((L), &(C), 0); lc_hasnext(&(C)) && ((E) = lc_next(&(C)), 1); )
+
 
 /** FUNCTION PROTOTYPES **/
 
 /**
- * NOTE: __ll_init(...) is not intended for use by the user. Use the wrapper
- * macro ll_init(...) instead.
+ * NOTE: __ll_init(...), __ll_init_unrolled(...), __ll_init_indexed(...),
+ * __ll_init_inline(...) and __ll_init_unrolled_inline(...) are not intended
+ * for use by the user. Use the wrapper macros ll_init(...),
+ * ll_init_unrolled(...), ll_init_indexed(...), ll_init_inline(...) and
+ * ll_init_unrolled_inline(...) instead.
  **/
 extern   llist_t*          __ll_init   (size_t __elem_size);
+extern   llist_t*          __ll_init_unrolled(size_t __elem_size,
+                                              int per_node);
+extern   llist_t*          __ll_init_indexed(size_t __elem_size);
+extern   llist_t*          __ll_init_inline(size_t __elem_size);
+extern   llist_t*          __ll_init_unrolled_inline(size_t __elem_size,
+                                                     int per_node);
 extern   void              ll_free     (llist_t* const list);
 
 extern   int   ll_size     (llist_t* const list);
@@ -74,6 +152,34 @@ extern   void* ll_remf     (llist_t* const list);
 extern   void* ll_reml     (llist_t* const list);
 extern   void* ll_set      (llist_t* const list, int index, void* const elem);
 
+extern   int   ll_rem_into (llist_t* const list, int index, void* const out);
+extern   int   ll_remf_into(llist_t* const list, void* const out);
+extern   int   ll_reml_into(llist_t* const list, void* const out);
+
+extern   void* ll_remval   (llist_t* const list, void* const elem);
+extern   int   ll_tofront  (llist_t* const list, void* const elem);
+extern   int   ll_toback   (llist_t* const list, void* const elem);
+extern   int   ll_hashindex(llist_t* const list, int on);
+
+extern   int   ll_remove_if(llist_t* const list,
+                            int (*pred)(void* const, void*), void* ctx,
+                            void (*funct)(void* const));
+extern   int   ll_retain   (llist_t* const list,
+                            int (*pred)(void* const, void*), void* ctx,
+                            void (*funct)(void* const));
+
+extern   int   ll_sort     (llist_t* const list,
+                            int (*cmp)(const void*, const void*));
+
+extern   int   ll_splice   (llist_t* const dst, int index,
+                            llist_t* const src);
+extern   int   ll_concat   (llist_t* const dst, llist_t* const src);
+extern   llist_t* ll_sub   (llist_t* const list, int from, int to);
+
+extern   int   ll_compact  (llist_t* const list);
+extern   int   ll_fragmentation(llist_t* const list);
+extern   void  ll_autocompact(llist_t* const list, int percent);
+
 extern   void**   ll_toarr (llist_t* const list);
 
 
@@ -86,8 +192,113 @@ extern   int         li_hasprev  (ll_itr_t* const itr);
 extern   void*       li_next     (ll_itr_t* const itr);
 extern   void*       li_prev     (ll_itr_t* const itr);
 
+extern   int         li_add      (ll_itr_t* const itr, void* const elem);
+extern   void*       li_rem      (ll_itr_t* const itr);
+extern   void*       li_set      (ll_itr_t* const itr, void* const elem);
+
+
+/* Linkedlist Node Pool Functions */
+extern   ll_pool_t*  ll_pool_init   (void);
+extern   void        ll_pool_free   (ll_pool_t* const pool);
+extern   int         ll_setpool     (llist_t* const list,
+                                     ll_pool_t* const pool);
+
+
+/* Linkedlist Cursor Functions */
+extern   int         ll_cur      (llist_t* const list, ll_cur_t* const cur,
+                                  int index);
+extern   void*       lc_next     (ll_cur_t* const cur);
+extern   void*       lc_prev     (ll_cur_t* const cur);
+
 #endif   /* __LIBDSTRUCTS_LIST_H__ */
 
+#ifndef __LIBDSTRUCTS_ILIST_H__
+#define __LIBDSTRUCTS_ILIST_H__   /* Guard against multiple inclusion */
+
+#include <stddef.h>
+
+
+/**
+ * Intrusive linkedlist hook. A hook is embedded in each element of an
+ * intrusive list, so that linking an element never allocates; an element
+ * with several hooks may be on several lists at once. A hook that is zeroed
+ * or has been unlinked is on no list. Its members are not intended for use
+ * by the user.
+ **/
+typedef struct __ill_hook_s {
+   struct __ill_hook_s *__next;
+   struct __ill_hook_s *__prev;
+} ill_hook_t;
+
+
+/**
+ * Intrusive linkedlist. Unlike llist_t, an intrusive list is owned by the
+ * caller and may be allocated on the stack or inside another structure;
+ * ill_init(...) prepares it. Its members are not intended for use by the
+ * user.
+ **/
+typedef struct __ill_s {
+   ill_hook_t __head;
+   size_t __offset;
+} ill_t;
+
+
+/**
+ * Wrapper macro for __ill_init(ill_t* const list, size_t offset), where
+ * member is the ill_hook_t member of type that links elements on this list.
+ **/
+#define ill_init(L, type, member) (__ill_init((L), offsetof(type, member)))
+
+/* Element of type containing hook H as member */
+#define ill_entry(H, type, member) \
+   ((type*) ((char*) (H) - offsetof(type, member)))
+
+/* Semantic macro for determining if an intrusive list is empty */
+#define ill_empty(L) ((L)->__head.__next == &(L)->__head)
+
+/* Semantic macro for determining if a hook is on a list */
+#define ill_linked(H) ((H)->__next != NULL)
+
+/**
+ * Loop over every element of an intrusive list, in order. E is assigned each
+ * element in turn. Use ill_foreach_safe(...) to unlink E within the loop,
+ * where N is a pointer holding the following element.
+ **/
+#define ill_foreach(L, E) \
+   for((E) = ill_first(L); (E); (E) = ill_next((L), (E)))
+#define ill_foreach_safe(L, E, N) \
+   for((E) = ill_first(L); (E) && ((N) = ill_next((L), (E)), 1); (E) = (N))
+
+
+/** FUNCTION PROTOTYPES **/
+
+/**
+ * NOTE: __ill_init(...) is not intended for use by the user. Use the wrapper
+ * macro ill_init(...) instead.
+ **/
+extern   void  __ill_init     (ill_t* const list, size_t offset);
+
+extern   int   ill_size       (ill_t* const list);
+
+extern   int   ill_addf       (ill_t* const list, void* const elem);
+extern   int   ill_addl       (ill_t* const list, void* const elem);
+extern   int   ill_addbefore  (ill_t* const list, void* const pos,
+                               void* const elem);
+extern   int   ill_addafter   (ill_t* const list, void* const pos,
+                               void* const elem);
+
+extern   void* ill_first      (ill_t* const list);
+extern   void* ill_last       (ill_t* const list);
+extern   void* ill_next       (ill_t* const list, void* const elem);
+extern   void* ill_prev       (ill_t* const list, void* const elem);
+
+extern   void* ill_rem        (ill_t* const list, void* const elem);
+extern   void* ill_remf       (ill_t* const list);
+extern   void* ill_reml       (ill_t* const list);
+extern   void  ill_unlink     (ill_hook_t* const hook);
+
+#endif   /* __LIBDSTRUCTS_ILIST_H__ */
+
 #ifndef __LIBDSTRUCTS_QUEUE_H__
 #define __LIBDSTRUCTS_QUEUE_H__
 
@@ -103,7 +314,22 @@ typedef struct que_s que_t;
 #define q_init(type) (__q_init(sizeof(type)))
 #define q_empty(Q) (!q_head(Q))
 
+/* Wrapper macro for __q_init_inline(...); elements are copied in and out */
+#define q_init_inline(type) (__q_init_inline(sizeof(type)))
+
+/**
+ * Wrapper macros for __q_init_ring(...) and __q_init_ring_inline(...). A ring
+ * queue keeps its elements, or pointers to them, in a growable circular
+ * array of at least cap slots.
+ **/
+#define q_init_ring(type, cap) (__q_init_ring(sizeof(type), (cap)))
+#define q_init_ring_inline(type, cap) \
+   (__q_init_ring_inline(sizeof(type), (cap)))
+
 extern que_t*  __q_init (size_t __elem_size);
+extern que_t*  __q_init_inline(size_t __elem_size);
+extern que_t*  __q_init_ring(size_t __elem_size, int cap);
+extern que_t*  __q_init_ring_inline(size_t __elem_size, int cap);
 extern void    q_free   (que_t* const q);
 
 extern int     q_size   (que_t* const q);
@@ -111,8 +337,56 @@ extern void*   q_head   (que_t* const q);
 extern void*   q_tail   (que_t* const q);
 extern void    q_enq    (que_t* const q, void* const elem);
 extern void*   q_deq    (que_t* const q);
+extern int     q_deq_into(que_t* const q, void* const out);
+extern int     q_enq_n  (que_t* const q, const void* const elems, int n);
+extern int     q_deq_n  (que_t* const q, void* const out, int n);
 extern void**  q_toarr  (que_t* const q);
 
+
+/**
+ * Single-producer, single-consumer queue public, opaque data type. Safe for
+ * one thread enqueueing alongside one thread dequeueing.
+ **/
+typedef struct __q_spsc_s q_spsc_t;
+
+/* Wrapper macro for __q_spsc_init(...); elements are copied in and out */
+#define q_spsc_init(type, cap) (__q_spsc_init(sizeof(type), (cap)))
+
+extern q_spsc_t* __q_spsc_init(size_t __elem_size, int cap);
+extern void    q_spsc_free (q_spsc_t* const q);
+
+extern int     q_spsc_size (q_spsc_t* const q);
+extern int     q_spsc_enq  (q_spsc_t* const q, const void* const elem);
+extern int     q_spsc_deq  (q_spsc_t* const q, void* const out);
+extern int     q_spsc_enq_n(q_spsc_t* const q, const void* const elems,
+                            int n);
+extern int     q_spsc_deq_n(q_spsc_t* const q, void* const out, int n);
+
+
+/**
+ * Multi-producer, multi-consumer queue public, opaque data type. Safe for any
+ * number of threads enqueueing and dequeueing at once.
+ **/
+typedef struct __q_mpmc_s q_mpmc_t;
+
+/* Wrapper macro for __q_mpmc_init(...); elements are copied in and out */
+#define q_mpmc_init(type, cap) (__q_mpmc_init(sizeof(type), (cap)))
+
+extern q_mpmc_t* __q_mpmc_init(size_t __elem_size, int cap);
+extern void    q_mpmc_free (q_mpmc_t* const q);
+
+extern int     q_mpmc_size (q_mpmc_t* const q);
+extern int     q_mpmc_try_enq(q_mpmc_t* const q, const void* const elem);
+extern int     q_mpmc_try_deq(q_mpmc_t* const q, void* const out);
+extern int     q_mpmc_try_enq_n(q_mpmc_t* const q, const void* const elems,
+                                int n);
+extern int     q_mpmc_try_deq_n(q_mpmc_t* const q, void* const out, int n);
+
+extern int     q_mpmc_enq_wait(q_mpmc_t* const q, const void* const elem,
+                               long timeout_ns);
+extern int     q_mpmc_deq_wait(q_mpmc_t* const q, void* const out,
+                               long timeout_ns);
+
 #endif   /* __LIBDSTRUCTS_QUEUE_H__ */
 
 #ifndef __LIBDSTRUCTS_STACK_H__
@@ -130,13 +404,38 @@ typedef struct stack_s stack_t;
 #define s_init(type) (__s_init(sizeof(type)))
 #define s_empty(S) (!s_top(S))
 
+/* Wrapper macro for __s_init_inline(...); elements are copied in and out */
+#define s_init_inline(type) (__s_init_inline(sizeof(type)))
+
+/**
+ * Wrapper macros for the array-backed stacks. An array stack keeps its
+ * elements, or pointers to them, in one array of at least cap slots that
+ * doubles when full. A segmented stack chains chunks of a fixed number of
+ * slots instead, so that growing never copies.
+ **/
+#define s_init_array(type, cap) (__s_init_array(sizeof(type), (cap)))
+#define s_init_array_inline(type, cap) \
+   (__s_init_array_inline(sizeof(type), (cap)))
+#define s_init_segmented(type, chunk) \
+   (__s_init_segmented(sizeof(type), (chunk)))
+#define s_init_segmented_inline(type, chunk) \
+   (__s_init_segmented_inline(sizeof(type), (chunk)))
+
 extern stack_t*  __s_init (size_t __elem_size);
+extern stack_t*  __s_init_inline(size_t __elem_size);
+extern stack_t*  __s_init_array(size_t __elem_size, int cap);
+extern stack_t*  __s_init_array_inline(size_t __elem_size, int cap);
+extern stack_t*  __s_init_segmented(size_t __elem_size, int chunk);
+extern stack_t*  __s_init_segmented_inline(size_t __elem_size, int chunk);
 extern void    s_free   (stack_t* const s);
 
 extern int     s_size   (stack_t* const s);
 extern void*   s_top    (stack_t* const s);
 extern void    s_push   (stack_t* const s, void* const elem);
 extern void*   s_pop    (stack_t* const s);
+extern int     s_pop_into(stack_t* const s, void* const out);
+extern int     s_push_n (stack_t* const s, const void* const elems, int n);
+extern int     s_pop_n  (stack_t* const s, void* const out, int n);
 extern void**  s_toarr  (stack_t* const s);
 
 #endif   /* __LIBDSTRUCTS_STACK_H__ */
@@ -256,9 +555,44 @@ typedef struct __vect_s vect_t;
 typedef struct __v_itr_s v_itr_t;
 
 
+/**
+ * Vector cursor. Unlike v_itr_t, a cursor is owned by the caller and may be
+ * allocated on the stack; v_cur(...) positions it. Stepping a cursor does not
+ * call into the library. Its members are not intended for use by the user. A
+ * cursor is invalidated when the vector is modified.
+ **/
+typedef struct __v_cur_s {
+   char *__base;
+   size_t __stride;
+   int __head;
+   int __mask;
+   int __pos;
+   int __end;
+   int __byval;
+} v_cur_t;
+
+
 /* Wrapper macro for __v_init(size_t __alloc_size) */
 #define v_init(type) (__v_init(sizeof(type)))
 
+/* Wrapper macro for __v_init_cap(size_t __alloc_size, int cap) */
+#define v_init_cap(type, cap) (__v_init_cap(sizeof(type), (cap)))
+
+/* Wrapper macro for __v_init_inline(size_t __alloc_size) */
+#define v_init_inline(type) (__v_init_inline(sizeof(type)))
+
+/* Wrapper macros for __v_init_ring(size_t __alloc_size, int by_value) */
+#define v_init_ring(type) (__v_init_ring(sizeof(type), 0))
+#define v_init_ring_inline(type) (__v_init_ring(sizeof(type), 1))
+
+/* Wrapper macro for __v_mmap_open(const char *path, size_t __alloc_size, ...) */
+#define v_mmap_open(path, type, flags) \
+   (__v_mmap_open((path), sizeof(type), (flags)))
+
+/* Flags for v_mmap_open(...) */
+#define V_MMAP_CREATE 0x1  /* Create the file if it does not exist */
+#define V_MMAP_TRUNC  0x2  /* Discard any elements already in the file */
+
 /* Semantic macro for determining if a v is empty */
 #define v_empty(V) (!v_first(V))
 
@@ -268,22 +602,73 @@ typedef struct __v_itr_s v_itr_t;
 /* Semantic macro for determining the tail of a vector */
 #define v_tail(V) (v_last(V))
 
+/**
+ * Built-in orderings for v_sort(...) and friends. Elements are compared by
+ * their bytes, as signed integers, or as unsigned integers, respectively.
+ * Integer orderings apply to elements of 1, 2, 4 or 8 bytes.
+ **/
+#define V_CMP_MEM  ((int (*)(const void*, const void*)) 0)
+#define V_CMP_INT  ((int (*)(const void*, const void*)) 1)
+#define V_CMP_UINT ((int (*)(const void*, const void*)) 2)
+
+/* Search kernels for __v_scan_force(...) */
+#define V_SCAN_AUTO   -1
+#define V_SCAN_SCALAR 0
+#define V_SCAN_SSE2   1
+#define V_SCAN_AVX2   2
+#define V_SCAN_AVX512 3
+
+/* Semantic macros for determining if a cursor has more elements */
+#define vc_hasnext(C) ((C)->__pos < (C)->__end)
+#define vc_hasprev(C) ((C)->__pos > 0)
+
+/* Element at position I of the vector under cursor C */
+#define __vc_elem(C, I) ((C)->__byval ? (void*) __vc_slot(C, I) \
+                                      : *(void**) __vc_slot(C, I))
+#define __vc_slot(C, I) ((C)->__base + \
+   (size_t) (((C)->__head + (I)) & (C)->__mask) * (C)->__stride)
+
+/* Retrieve the next or previous element of cursor C, moving the cursor */
+#define vc_next(C) (vc_hasnext(C) ? __vc_elem(C, (C)->__pos++) : NULL)
+#define vc_prev(C) (vc_hasprev(C) ? __vc_elem(C, --(C)->__pos) : NULL)
+
+/**
+ * Loop over every element of a vector, in order, without allocating. E is
+ * assigned each element in turn and C is the v_cur_t used to walk the vector.
+ **/
+#define v_foreach(V, E, C) \
+   for(v_cur((V), &(C), 0); vc_hasnext(&(C)) && \
+       ((E) = __vc_elem(&(C), (C).__pos), 1); (C).__pos++)
+
 
 /** FUNCTION PROTOTYPES **/
 
 /**
- * NOTE: __v_init(...) is not intended for use by the user. Use the wrapper
- * macro v_init(...) instead.
+ * NOTE: __v_init(...), __v_init_cap(...), __v_init_inline(...),
+ * __v_init_ring(...) and __v_mmap_open(...) are not intended for use by the
+ * user. Use the wrapper macros v_init(...), v_init_cap(...),
+ * v_init_inline(...), v_init_ring(...), v_init_ring_inline(...) and
+ * v_mmap_open(...) instead.
  **/
 extern   vect_t*  __v_init(size_t __elem_size);
+extern   vect_t*  __v_init_cap(size_t __elem_size, int cap);
+extern   vect_t*  __v_init_inline(size_t __elem_size);
+extern   vect_t*  __v_init_ring(size_t __elem_size, int by_value);
+extern   vect_t*  __v_mmap_open(const char *path, size_t __elem_size,
+                                int flags);
 extern   void     v_free  (vect_t* const v);
+extern   int      v_sync  (vect_t* const v);
 
 extern   int   v_size     (vect_t* const v);
 extern   int   v_cap      (vect_t* const v);
+extern   void* v_data     (vect_t* const v);
+extern   int   v_reserve  (vect_t* const v, int cap);
 
 extern   void  v_addf     (vect_t* const v, void* const elem);
 extern   void  v_addl     (vect_t* const v, void* const elem);
 extern   int   v_add      (vect_t* const v, int index, void* const elem);
+extern   int   v_addall   (vect_t* const v, int index, void* const elems,
+                           int n);
 
 extern   void  v_clear    (vect_t* const v);
 extern   int   v_contains (vect_t* const v, void* const elem);
@@ -298,11 +683,29 @@ extern   void  v_apply    (vect_t* const v, void (*funct)(void* const));
 extern   void* v_rem      (vect_t* const v, int index);
 extern   void* v_remf     (vect_t* const v);
 extern   void* v_reml     (vect_t* const v);
+extern   int   v_rem_range(vect_t* const v, int from, int to,
+                           void (*funct)(void* const));
 extern   void* v_set      (vect_t* const v, int index, void* const elem);
 
+extern   int   v_remove_if(vect_t* const v, int (*pred)(void* const, void*),
+                           void* ctx, void (*funct)(void* const));
+extern   int   v_retain   (vect_t* const v, int (*pred)(void* const, void*),
+                           void* ctx, void (*funct)(void* const));
+
 extern   void**   v_toarr (vect_t* const v);
 extern   void     v_trim  (vect_t* const v);
 
+extern   int   v_sort      (vect_t* const v,
+                            int (*cmp)(const void*, const void*));
+extern   int   v_bsearch   (vect_t* const v, void* const elem,
+                            int (*cmp)(const void*, const void*));
+extern   int   v_keepsorted(vect_t* const v,
+                            int (*cmp)(const void*, const void*));
+extern   void  v_dropsorted(vect_t* const v);
+
+/* Not intended for use by the user; forces a search kernel for testing */
+extern   int   __v_scan_force(int level);
+
 
 /* Vector Iterator Functions */
 extern   v_itr_t*    v_itr       (vect_t* const v, int index);
@@ -313,5 +716,10 @@ extern   int         vi_hasprev  (v_itr_t* const itr);
 extern   void*       vi_next     (v_itr_t* const itr);
 extern   void*       vi_prev     (v_itr_t* const itr);
 
+
+/* Vector Cursor Functions */
+extern   int         v_cur       (vect_t* const v, v_cur_t* const cur,
+                                  int index);
+
 #endif   /* __LIBDSTRUCTS_VECTOR_H__ */
 
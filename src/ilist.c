@@ -0,0 +1,287 @@
+/**
+ * libdstructs: a simple, generic data structures library written in ANSI C.
+ *
+ * Copyright (C) 2013, 2014 Evan Bezeredi <bezeredi.dev@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see {http://www.gnu.org/licenses/}.
+ **/
+#include <stdlib.h>     /* For NULL */
+#include "dstructs.h"       /* For ill_t, ill_hook_t */
+
+
+#define ADDED 1
+
+
+/* Local functions */
+static void __ill_link(ill_hook_t* const prev, ill_hook_t* const hook);
+
+
+/* Hook of an element, and element of a hook, on a specified list */
+#define __HOOK(L, E) ((ill_hook_t*) ((char*) (E) + (L)->__offset))
+#define __ELEM(L, H) ((void*) ((char*) (H) - (L)->__offset))
+
+
+/**
+ * Prepares an intrusive list, which is kept as a ring of hooks through the
+ * list's own head. Nothing is allocated, here or anywhere else in the
+ * intrusive list.
+ *
+ * NOTE: This is a function that is not intended for use by the user. The user
+ * should instead use the macro ill_init(list, type, member), where member is
+ * the ill_hook_t member of type that links elements on this list.
+ *
+ * @param list - the list to prepare.
+ * @param offset - the offset of the hook within an element.
+ **/
+void __ill_init(ill_t* const list, size_t offset) {
+   if(!list) return;
+
+   list->__head.__next = &list->__head;
+   list->__head.__prev = &list->__head;
+   list->__offset = offset;
+}
+
+
+/**
+ * Counts the elements of an intrusive list. The list keeps no count, so
+ * that unlinking needs only a hook; this takes O(n) time.
+ *
+ * @param list - the list to count.
+ * @return the length of the list. Returns -1 if the list is NULL.
+ **/
+int ill_size(ill_t* const list) {
+   ill_hook_t *hook;
+   int count;
+
+   if(!list) return -1;
+
+   count = 0;
+
+   for(hook = list->__head.__next; hook != &list->__head; hook = hook->__next)
+      count++;
+
+   return count;
+}
+
+
+/**
+ * Adds an element to the front of an intrusive list.
+ *
+ * @param list - the list to add the element to.
+ * @param elem - the element to add.
+ * @return 1 if the element is added. Returns 0 if either pointer is NULL or
+ *    the element's hook is already on a list.
+ **/
+int ill_addf(ill_t* const list, void* const elem) {
+   if(!list || !elem) return !ADDED;
+
+   if(ill_linked(__HOOK(list, elem))) return !ADDED;
+
+   __ill_link(&list->__head, __HOOK(list, elem));
+   return ADDED;
+}
+
+
+/**
+ * Adds an element to the end of an intrusive list.
+ *
+ * @param list - the list to add the element to.
+ * @param elem - the element to add.
+ * @return 1 if the element is added. Returns 0 if either pointer is NULL or
+ *    the element's hook is already on a list.
+ **/
+int ill_addl(ill_t* const list, void* const elem) {
+   if(!list || !elem) return !ADDED;
+
+   if(ill_linked(__HOOK(list, elem))) return !ADDED;
+
+   __ill_link(list->__head.__prev, __HOOK(list, elem));
+   return ADDED;
+}
+
+
+/**
+ * Adds an element to an intrusive list just before another element.
+ *
+ * @param list - the list to add the element to.
+ * @param pos - an element on the list.
+ * @param elem - the element to add.
+ * @return 1 if the element is added. Returns 0 if any pointer is NULL, pos
+ *    is on no list, or the element's hook is already on a list.
+ **/
+int ill_addbefore(ill_t* const list, void* const pos, void* const elem) {
+   if(!list || !pos || !elem) return !ADDED;
+
+   if(!ill_linked(__HOOK(list, pos)) || ill_linked(__HOOK(list, elem)))
+      return !ADDED;
+
+   __ill_link(__HOOK(list, pos)->__prev, __HOOK(list, elem));
+   return ADDED;
+}
+
+
+/**
+ * Adds an element to an intrusive list just after another element.
+ *
+ * @param list - the list to add the element to.
+ * @param pos - an element on the list.
+ * @param elem - the element to add.
+ * @return 1 if the element is added. Returns 0 if any pointer is NULL, pos
+ *    is on no list, or the element's hook is already on a list.
+ **/
+int ill_addafter(ill_t* const list, void* const pos, void* const elem) {
+   if(!list || !pos || !elem) return !ADDED;
+
+   if(!ill_linked(__HOOK(list, pos)) || ill_linked(__HOOK(list, elem)))
+      return !ADDED;
+
+   __ill_link(__HOOK(list, pos), __HOOK(list, elem));
+   return ADDED;
+}
+
+
+/**
+ * Retrieves (but does not remove) the first element of an intrusive list.
+ *
+ * @param list - the list to retrieve the element from.
+ * @return the first element. Returns NULL if the list is NULL or empty.
+ **/
+void* ill_first(ill_t* const list) {
+   if(!list || ill_empty(list)) return NULL;
+
+   return __ELEM(list, list->__head.__next);
+}
+
+
+/**
+ * Retrieves (but does not remove) the last element of an intrusive list.
+ *
+ * @param list - the list to retrieve the element from.
+ * @return the last element. Returns NULL if the list is NULL or empty.
+ **/
+void* ill_last(ill_t* const list) {
+   if(!list || ill_empty(list)) return NULL;
+
+   return __ELEM(list, list->__head.__prev);
+}
+
+
+/**
+ * Retrieves the element following another on an intrusive list.
+ *
+ * @param list - the list the element is on.
+ * @param elem - an element on the list.
+ * @return the following element. Returns NULL if either pointer is NULL or
+ *    the element is the last.
+ **/
+void* ill_next(ill_t* const list, void* const elem) {
+   ill_hook_t *hook;
+
+   if(!list || !elem) return NULL;
+
+   hook = __HOOK(list, elem)->__next;
+
+   return (hook == &list->__head ? NULL : __ELEM(list, hook));
+}
+
+
+/**
+ * Retrieves the element preceding another on an intrusive list.
+ *
+ * @param list - the list the element is on.
+ * @param elem - an element on the list.
+ * @return the preceding element. Returns NULL if either pointer is NULL or
+ *    the element is the first.
+ **/
+void* ill_prev(ill_t* const list, void* const elem) {
+   ill_hook_t *hook;
+
+   if(!list || !elem) return NULL;
+
+   hook = __HOOK(list, elem)->__prev;
+
+   return (hook == &list->__head ? NULL : __ELEM(list, hook));
+}
+
+
+/**
+ * Removes an element from an intrusive list in O(1) time.
+ *
+ * @param list - the list the element is on.
+ * @param elem - the element to remove.
+ * @return the element. Returns NULL if either pointer is NULL or the
+ *    element's hook is on no list.
+ **/
+void* ill_rem(ill_t* const list, void* const elem) {
+   if(!list || !elem) return NULL;
+
+   if(!ill_linked(__HOOK(list, elem))) return NULL;
+
+   ill_unlink(__HOOK(list, elem));
+   return elem;
+}
+
+
+/**
+ * Removes and returns the first element of an intrusive list.
+ *
+ * @param list - the list to remove the element from.
+ * @return the first element. Returns NULL if the list is NULL or empty.
+ **/
+void* ill_remf(ill_t* const list) {
+   return ill_rem(list, ill_first(list));
+}
+
+
+/**
+ * Removes and returns the last element of an intrusive list.
+ *
+ * @param list - the list to remove the element from.
+ * @return the last element. Returns NULL if the list is NULL or empty.
+ **/
+void* ill_reml(ill_t* const list) {
+   return ill_rem(list, ill_last(list));
+}
+
+
+/**
+ * Unlinks a hook from whichever list it is on, in O(1) time. Neither the
+ * list nor the element is needed. Unlinking a hook on no list does nothing.
+ *
+ * @param hook - the hook to unlink.
+ **/
+void ill_unlink(ill_hook_t* const hook) {
+   if(!hook || !hook->__next) return;
+
+   hook->__prev->__next = hook->__next;
+   hook->__next->__prev = hook->__prev;
+
+   hook->__next = NULL;
+   hook->__prev = NULL;
+}
+
+
+/**
+ * Link a hook into a ring of hooks after another.
+ *
+ * @param prev - the hook to link after.
+ * @param hook - the hook to link.
+ **/
+static void __ill_link(ill_hook_t* const prev, ill_hook_t* const hook) {
+   hook->__prev = prev;
+   hook->__next = prev->__next;
+
+   prev->__next->__prev = hook;
+   prev->__next = hook;
+}
@@ -16,14 +16,87 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see {http://www.gnu.org/licenses/}.
  **/
+#include <limits.h>     /* For INT_MAX */
+#include <stddef.h>     /* For offsetof(...) */
+#include <stdint.h>     /* For int64_t, uint64_t */
 #include <stdlib.h>     /* For malloc(...), free(...) */
-#include <string.h>     /* For memcmp(...) */
-#include "dstructs.h"       /* For llist_t, ll_itr_t */
+#include <string.h>     /* For memcmp(...), memmove(...) */
+#include "dstructs.h"       /* For llist_t, ll_itr_t, ll_cur_t */
 
 
 #define ADDED 1
 #define EXIST 1
 
+#define CACHE_LINE 64         /* Alignment of pool chunks */
+#define POOL_INIT_NODES 4     /* Nodes in the first chunk of a pool */
+#define POOL_MAX_NODES 4096   /* Nodes in any later chunk of a pool */
+#define UNROLL_LINES 2        /* Cache lines per unrolled node by default */
+#define SKIP_LEVELS 16        /* Index levels above the nodes */
+#define SKIP_WALK 8           /* Walks shorter than this skip the index */
+#define SKIP_SEED 2463534242u
+#define SORT_BINS 64          /* Sorted runs of 2^i nodes while sorting */
+#define COMPACT_MIN 64        /* Smallest list compacted automatically */
+#define HASH_MIN 16           /* Fewest slots in a hash index */
+
+#define LL_UNROLLED 0x1       /* Nodes hold arrays of elements */
+#define LL_INDEXED 0x2        /* A skip list indexes the nodes */
+#define LL_HASHED 0x4         /* A hash table indexes the elements */
+#define LL_INLINE 0x8         /* Nodes hold copies of the elements */
+
+
+/* Local functions */
+static llist_t* __ll_create(size_t elem_size, int flags, int per_node);
+static void* __ll_alloc(llist_t* const list);
+static void  __ll_release(llist_t* const list, void* const node);
+static void  __ll_pool_drop(ll_pool_t* const pool);
+static void* __ll_chunk(ll_pool_t* const pool, int nodes);
+static void  __ll_unchunk(void* chunks);
+static void  __ll_check_compact(llist_t* const list);
+static void* __ll_node(llist_t* const list, int index);
+static void  __ll_join(llist_t* const list, void* const a, void* const b);
+static int   __ll_adopt(llist_t* const dst, llist_t* const src);
+static int   __ll_move(llist_t* const dst, int index, llist_t* const src);
+static int64_t __ll_key(const void* elem, size_t width, int is_signed);
+static int   __ll_order(int (*cmp)(const void*, const void*), size_t width,
+                        const void* a, const void* b);
+static void* __ll_merge(void* a, void* b,
+                        int (*cmp)(const void*, const void*), size_t width,
+                        int keyed);
+static int   __ul_sort(llist_t* const list,
+                       int (*cmp)(const void*, const void*));
+static void* __ul_node(llist_t* const list, int* const index);
+static int   __ul_add(llist_t* const list, int index, void* const elem);
+static void* __ul_rem(llist_t* const list, int index);
+static void* __ul_replace(llist_t* const list, void* const node, int slot,
+                          void* const elem);
+static int   __ul_filter(llist_t* const list, int (*pred)(void* const, void*),
+                         void* ctx, void (*funct)(void* const), int keep);
+static void* __ul_next(void** const node, int* const slot);
+static void* __ul_prev(void** const node, int* const slot);
+static int   __ul_cut(llist_t* const list, int index, void** const node);
+static void  __ll_seek(llist_t* const list, int index, ll_cur_t* const cur);
+static int   __sk_build(llist_t* const list);
+static void  __sk_drop(llist_t* const list);
+static void* __sk_find(llist_t* const list, int index);
+static void  __sk_insert(llist_t* const list, void* const node, int index);
+static void  __sk_remove(llist_t* const list, void* const node, int index);
+static int __ll_filter(llist_t* const list, int (*pred)(void* const, void*),
+                       void* ctx, void (*funct)(void* const), int keep);
+static void* __ll_lookup(llist_t* const list, void* const elem,
+                         int* const index);
+static int   __ll_toend(llist_t* const list, void* const elem, int back);
+static void* __ll_detach(llist_t* const list, int index);
+static void* __ll_out(llist_t* const list, void* const node, void* const out);
+static void* __ll_replace(llist_t* const list, void* const node,
+                          void* const elem);
+static int   __ht_ready(llist_t* const list);
+static int   __ht_build(llist_t* const list);
+static void  __ht_drop(llist_t* const list);
+static void* __ht_find(llist_t* const list, void* const elem,
+                       int* const dups);
+static void  __ht_insert(llist_t* const list, void* const node);
+static void  __ht_remove(llist_t* const list, void* const node);
+
 
 /**
  * Internal linkedlist definition.
@@ -32,16 +105,59 @@ struct __llist_s {
    void *__first;
    void *__last;
    size_t __elem_size;
+   size_t __node_size;  /* Bytes per node, as carved from the pool */
    int __size;
+   int __flags;
+   int __per_node;      /* Element slots per node when unrolled */
+   ll_pool_t *__pool;
+   void *__finger;      /* Last node reached by index, or NULL */
+   int __fidx;          /* Index of the finger node */
+   void *__skip;        /* Head of the skip list index, or NULL if unbuilt */
+   unsigned int __seed; /* State for picking tower heights */
+   int __churn;         /* Nodes released since the last compaction */
+   int __autocompact;   /* Churn, as a percentage of size, to compact at */
+   void *__htab;        /* Slots of the hash index, or NULL if unbuilt */
+   size_t __hmask;      /* Slots in the hash index, less one */
+   void *__spare;       /* Copy of the element last removed, when inline */
+};
+
+
+/**
+ * Internal node pool definition. Nodes are carved from cache-line-aligned
+ * chunks and freed nodes are kept on a free list for reuse. Chunks are linked
+ * through their first cache line and only released with the pool. Chunks
+ * start small and double, so a short list costs little.
+ **/
+struct __ll_pool_s {
+   void *__free;        /* Free list, linked through each node's first word */
+   void *__flast;       /* Last node of the free list */
+   char *__bump;        /* Next never-used node in the newest chunk */
+   char *__end;         /* End of the newest chunk */
+   void *__chunks;
+   void *__clast;       /* Oldest chunk, at the end of the chain */
+   size_t __node_size;
+   int __chunk_nodes;   /* Nodes in the next chunk */
+   int __refs;          /* Lists using the pool, plus its creator */
 };
 
 
+/**
+ * A pool is private while it has one reference, that of the only list using
+ * it: no other list holds its nodes, and no creator may hand it to one.
+ **/
+#define __SHARED(P) ((P)->__refs > 1)
+
+
 /**
  * Internal linkedlist iterator definition.
  **/
 struct __ll_iter_s {
-   void *__next;
-   void *__prev;
+   ll_cur_t __cur;      /* Position between two elements */
+   llist_t *__list;
+   void *__last;        /* Node of the element last returned, or NULL */
+   int __lslot;         /* Slot of that element when unrolled, else -1 */
+   int __lidx;          /* Index of that element */
+   int __index;         /* Index of the next element */
 };
 
 
@@ -56,6 +172,63 @@ typedef struct __node_s {
 } __node_t;
 
 
+/* The element bytes of a node of an inline list, just past its links */
+#define __INLINE(N) ((void*) ((__node_t*) (N) + 1))
+
+
+/**
+ * Internal node type of an unrolled list. The slot array is allocated with
+ * room for the list's per-node count and kept packed from slot zero. A slot
+ * holds a pointer to an element or, if the list is inline, the element's
+ * bytes, aligned as malloc(...) would align them.
+ **/
+typedef struct __unode_s {
+   struct __unode_s *prev;
+   struct __unode_s *next;
+   int count;
+   int width;           /* Bytes per inline element; 0 (zero) for pointers */
+   union {
+      void *ptr;
+      long double align;
+   } elems[1];
+} __unode_t;
+
+
+/* Bytes per slot of an unrolled list, and slot I of an unrolled node */
+#define __USIZE(L) \
+   ((L)->__flags & LL_INLINE ? (L)->__elem_size : sizeof(void*))
+#define __USLOT(U, I) ((char*) (U)->elems + (size_t) (I) * \
+   ((U)->width ? (size_t) (U)->width : sizeof(void*)))
+
+/* Element in slot I of an unrolled node */
+#define __UELEM(U, I) ((U)->width ? (void*) __USLOT(U, I) : \
+                                    *(void**) __USLOT(U, I))
+
+
+/**
+ * Internal skip list tower. A tower stands on a node of an indexed list and
+ * has one link per level; the width of a link is the number of nodes it
+ * spans. The head tower stands before the first node and has every level.
+ **/
+typedef struct __tower_s {
+   __node_t *node;
+   struct __level_s {
+      struct __tower_s *next;
+      int width;
+   } lvl[1];
+} __tower_t;
+
+
+/**
+ * Internal hash index slot. Slots are probed linearly; an empty slot has no
+ * node. The hash of the node's element is kept to skip most comparisons.
+ **/
+typedef struct __hslot_s {
+   __node_t *node;
+   uint64_t hash;
+} __hslot_t;
+
+
 /**
  * A simulated constructor for a linkedlist.
  *
@@ -68,18 +241,158 @@ typedef struct __node_s {
  *    allocation error.
  **/
 llist_t* __ll_init(size_t __elem_size) {
+   return __ll_create(__elem_size, 0, 1);
+}
+
+
+/**
+ * A simulated constructor for an unrolled linkedlist. Each node of an
+ * unrolled list holds a small array of elements, so walking the list touches
+ * far fewer cache lines. Nodes split when full and merge with a neighbour
+ * when less than half full. Every ll_* function works on it as on any list.
+ *
+ * NOTE: This is a function that is not intended for use by the user. The user
+ * should instead use the macro ll_init_unrolled(type, per_node).
+ *
+ * @param __elem_size - the size of an element in the linkedlist.
+ * @param per_node - the number of elements each node holds; 0 (zero) picks
+ *    as many as fill two cache lines.
+ * @return a pointer to an empty linkedlist. Returns a NULL pointer if
+ *    per_node is negative or upon allocation error.
+ **/
+llist_t* __ll_init_unrolled(size_t __elem_size, int per_node) {
+   if(per_node < 0) return NULL;
+
+   return __ll_create(__elem_size, LL_UNROLLED, per_node);
+}
+
+
+/**
+ * A simulated constructor for an inline unrolled linkedlist, whose nodes
+ * hold copies of the elements in their slots rather than pointers, so that
+ * a walk reads the elements straight from the nodes. Elements are copied in
+ * and out as in an inline list (see ll_init_inline(...)), except that
+ * elements move between slots as the list changes: a pointer to an element
+ * is valid only until the list is next modified.
+ *
+ * NOTE: This is a function that is not intended for use by the user. The user
+ * should instead use the macro ll_init_unrolled_inline(type, per_node).
+ *
+ * @param __elem_size - the size of an element in the linkedlist.
+ * @param per_node - the number of elements each node holds; 0 (zero) picks
+ *    as many as fill two cache lines, and at least one.
+ * @return a pointer to an empty linkedlist. Returns a NULL pointer if
+ *    per_node is negative, the element size is zero (0), or upon allocation
+ *    error.
+ **/
+llist_t* __ll_init_unrolled_inline(size_t __elem_size, int per_node) {
+   if(per_node < 0 || !__elem_size) return NULL;
+
+   return __ll_create(__elem_size, LL_UNROLLED | LL_INLINE, per_node);
+}
+
+
+/**
+ * A simulated constructor for an indexed linkedlist. An indexed list keeps
+ * an indexable skip list above its nodes, so ll_add(...), ll_rem(...),
+ * ll_get(...) and ll_set(...) at any position take O(log n) time. Functions
+ * that rearrange many nodes at once, such as ll_remove_if(...), discard the
+ * index; it is rebuilt in O(n) by the next positional access.
+ *
+ * NOTE: This is a function that is not intended for use by the user. The user
+ * should instead use the macro ll_init_indexed(type).
+ *
+ * @param __elem_size - the size of an element in the linkedlist.
+ * @return a pointer to an empty linkedlist. Returns a NULL pointer upon
+ *    allocation error.
+ **/
+llist_t* __ll_init_indexed(size_t __elem_size) {
+   return __ll_create(__elem_size, LL_INDEXED, 1);
+}
+
+
+/**
+ * A simulated constructor for an inline linkedlist, which stores copies of
+ * its elements inside its nodes rather than pointers to them. Adding copies
+ * the element's bytes in, so the caller need not allocate it, and reading an
+ * element touches only its node. Functions returning an element return a
+ * pointer into its node, valid while the element is on the list; removing
+ * functions return a pointer to a copy held by the list, valid until the
+ * next removal, or copy into a buffer with ll_rem_into(...).
+ *
+ * NOTE: This is a function that is not intended for use by the user. The user
+ * should instead use the macro ll_init_inline(type).
+ *
+ * @param __elem_size - the size of an element in the linkedlist.
+ * @return a pointer to an empty linkedlist. Returns a NULL pointer upon
+ *    allocation error.
+ **/
+llist_t* __ll_init_inline(size_t __elem_size) {
+   return __ll_create(__elem_size, LL_INLINE, 1);
+}
+
+
+/**
+ * Allocate and initialize an empty list.
+ *
+ * @param flags - LL_UNROLLED, LL_INDEXED or LL_INLINE, or zero (0) for a
+ *    plain list.
+ * @param per_node - the number of elements each node holds; 0 (zero) for
+ *    an unrolled list picks as many as fill two cache lines.
+ * @return a pointer to an empty linkedlist. Returns a NULL pointer upon
+ *    allocation error.
+ **/
+static llist_t* __ll_create(size_t elem_size, int flags, int per_node) {
    llist_t *list;
+   size_t node, size;
 
-   list = malloc(sizeof(llist_t));
+   /* An inline list keeps its spare element just past itself */
+   list = malloc(sizeof(llist_t) + (flags & LL_INLINE ? elem_size : 0));
 
    /* Alloc error */
    if(!list) return NULL;
 
+   if(flags & LL_UNROLLED) {
+      size = (flags & LL_INLINE ? elem_size : sizeof(void*));
+
+      if(!per_node)
+         per_node = (int) ((UNROLL_LINES * CACHE_LINE -
+                            offsetof(__unode_t, elems)) / size);
+
+      if(!per_node) per_node = 1;
+
+      node = offsetof(__unode_t, elems) + per_node * size;
+   }
+   else if(flags & LL_INLINE)
+      node = sizeof(__node_t) + elem_size;
+   else
+      node = sizeof(__node_t);
+
+   /* Round up so that no node straddles a cache line */
+   for(size = sizeof(void*); size < node; size <<= 1)
+      ;
+
+   if(size > CACHE_LINE)
+      size = (node + CACHE_LINE - 1) & ~(size_t) (CACHE_LINE - 1);
+
    /* Initialize */
    list->__first = NULL;
    list->__last = NULL;
-   list->__elem_size = __elem_size;
+   list->__elem_size = elem_size;
+   list->__node_size = size;
    list->__size = 0;
+   list->__flags = flags;
+   list->__per_node = per_node;
+   list->__pool = NULL;    /* Created on first add */
+   list->__finger = NULL;
+   list->__fidx = 0;
+   list->__skip = NULL;    /* Built on first positional access */
+   list->__seed = SKIP_SEED;
+   list->__churn = 0;
+   list->__autocompact = 0;
+   list->__htab = NULL;    /* Built once hashing is turned on */
+   list->__hmask = 0;
+   list->__spare = (flags & LL_INLINE ? (void*) (list + 1) : NULL);
 
    return list;
 }
@@ -94,6 +407,9 @@ void ll_free(llist_t* const list) {
    if(!list) return;
 
    ll_clear(list);   /* Remove elements in list */
+   __sk_drop(list);
+   __ht_drop(list);
+   __ll_pool_drop(list->__pool);
    free(list);
 }
 
@@ -122,76 +438,71 @@ int ll_size(llist_t* const list) {
  **/
 int ll_add(llist_t* const list, int index, void* const elem) {
    __node_t *temp, *new;
-   int count;
 
    if(!list) return !ADDED;
 
    if(index < 0 || index > list->__size)
       return !ADDED;
 
-   new = malloc(sizeof(__node_t));  /* Allocate */
+   if((list->__flags & LL_INLINE) && !elem) return !ADDED;
+
+   if(list->__flags & LL_UNROLLED) {
+      if(!__ul_add(list, index, elem)) return !ADDED;
+
+      __ll_check_compact(list);
+      return ADDED;
+   }
+
+   new = __ll_alloc(list);  /* Allocate */
 
    if(!new) return !ADDED;
 
 
    /* Initialize */
-   new->element = elem;
-   new->index = index;
-   new->prev = NULL;
-   new->next = NULL;
+   if(list->__flags & LL_INLINE)
+      new->element = memcpy(__INLINE(new), elem, list->__elem_size);
+   else
+      new->element = elem;
 
-   /* Adding to empty list */
-   if(ll_empty(list)) {
-      list->__first = new;
-      list->__last = new;
-
-      list->__size++;
-      return ADDED;
-   }
+   new->index = index;
 
-   /* Adding to end of list */
+   /* Adding to end of list (or to an empty list) */
    if(index == list->__size) {
-      temp = list->__last;
-      temp->next = new;
-      new->prev = temp;
-      list->__last = new;
+      new->next = NULL;
+      new->prev = list->__last;
 
-      list->__size++;
-      return ADDED;
-   }
-
-   /* Adding to front of list */
-   if(index == 0) {
-      new->next = list->__first;
-      ((__node_t*) list->__first)->prev = new;
-      list->__first = new;
+      if(list->__last)
+         ((__node_t*) list->__last)->next = new;
+      else
+         list->__first = new;
+      list->__last = new;
    }
 
-   /* Adding somewhere in middle of list */
+   /* Adding in front of the node currently at index */
    else {
-      count = 0;
-      temp = list->__first;
+      temp = __ll_node(list, index);
 
-      /* Loop until temp is at the desired index */
-      while(temp->next) {
-         if(count == index) {
-            new->next = temp->next;
-            new->prev = temp;
-            temp->next->prev = new;
-            temp->next = new;
-
-            break;
-         }
+      new->next = temp;
+      new->prev = temp->prev;
 
-         temp = temp->next;
-         count++;
-      }
+      if(temp->prev)
+         temp->prev->next = new;
+      else
+         list->__first = new;
+      temp->prev = new;
    }
 
-   temp = new->next;
+   __sk_insert(list, new, index);
+   __ht_insert(list, new);
+
+   /* The new node is the nearest known position */
+   list->__finger = new;
+   list->__fidx = index;
 
    /* Item added */
    list->__size++;
+
+   __ll_check_compact(list);
    return ADDED;
 }
 
@@ -237,8 +548,19 @@ void ll_clear(llist_t* const list) {
     * While the list is not empty, remove
     * the first element in the list.
     **/
-   while(!ll_empty(list))
-      free(ll_remf(list));
+   while(list->__size)
+      if(list->__flags & LL_INLINE)
+         ll_remf(list);
+      else
+         free(ll_remf(list));
+
+   __ht_drop(list);
+
+   /* Every node of a private pool is free; give the memory back */
+   if(list->__pool && !__SHARED(list->__pool)) {
+      __ll_pool_drop(list->__pool);
+      list->__pool = NULL;
+   }
 }
 
 
@@ -251,25 +573,24 @@ void ll_clear(llist_t* const list) {
  *    or if the list is NULL;
  **/
 int ll_contains(llist_t* const list, void* const elem) {
-   __node_t *temp;
+   __unode_t *un;
    size_t num_bytes;
+   int i;
 
    if(!list) return !EXIST;
 
-   temp = list->__first;
    num_bytes = list->__elem_size;
 
-   /* Loop through to find the element */
-   while(temp) {
-      /* If the element is found */
-      if(memcmp(elem, temp->element, num_bytes) == 0)
-         return EXIST;
+   if(list->__flags & LL_UNROLLED) {
+      for(un = list->__first; un; un = un->next)
+         for(i = 0; i < un->count; i++)
+            if(memcmp(elem, __UELEM(un, i), num_bytes) == 0)
+               return EXIST;
 
-      temp = temp->next;
+      return !EXIST;
    }
 
-   /* Element does not exist */
-   return !EXIST;
+   return (__ll_lookup(list, elem, &i) ? EXIST : !EXIST);
 }
 
 
@@ -285,27 +606,20 @@ int ll_contains(llist_t* const list, void* const elem) {
  **/
 void* ll_get(llist_t* const list, int index) {
    __node_t *temp;
-   int count;
+   __unode_t *un;
 
    if(!list) return NULL;
 
    if(index < 0 || index >= list->__size)
       return NULL;
 
-   temp = list->__first;
-   count = 0;
-
-   /* Loop until desired index is found */
-   while(temp) {
-      if(count == index)
-         return temp->element;   /* Return the element */
-
-      temp = temp->next;
-      count++;
+   if(list->__flags & LL_UNROLLED) {
+      un = __ul_node(list, &index);
+      return __UELEM(un, index);
    }
 
-   /* Index not found */
-   return NULL;
+   temp = __ll_node(list, index);
+   return temp->element;
 }
 
 
@@ -318,7 +632,12 @@ void* ll_get(llist_t* const list, int index) {
  *    empty.
  **/
 void* ll_first(llist_t* const list) {
-   return ll_get(list, 0);
+   if(!list || !list->__first) return NULL;
+
+   if(list->__flags & LL_UNROLLED)
+      return __UELEM((__unode_t*) list->__first, 0);
+
+   return ((__node_t*) list->__first)->element;
 }
 
 
@@ -331,7 +650,13 @@ void* ll_first(llist_t* const list) {
  *    empty.
  **/
 void* ll_last(llist_t* const list) {
-   return ll_get(list, list->__size - 1);
+   if(!list || !list->__last) return NULL;
+
+   if(list->__flags & LL_UNROLLED)
+      return __UELEM((__unode_t*) list->__last,
+                     ((__unode_t*) list->__last)->count - 1);
+
+   return ((__node_t*) list->__last)->element;
 }
 
 
@@ -346,27 +671,35 @@ void* ll_last(llist_t* const list) {
  **/
 int ll_indexof(llist_t* const list, void* const elem) {
    __node_t *temp;
+   __unode_t *un;
    size_t num_bytes;
-   int count;
+   int count, i;
 
    if(!list) return -1;
 
-   temp = list->__first;
    num_bytes = list->__elem_size;
    count = 0;
 
-   /* Look for first occurrence of element */
-   while(temp) {
-      /* If the element is found */
-      if(memcmp(elem, temp->element, num_bytes) == 0)
-         return count;
+   if(list->__flags & LL_UNROLLED) {
+      for(un = list->__first; un; count += un->count, un = un->next)
+         for(i = 0; i < un->count; i++)
+            if(memcmp(elem, __UELEM(un, i), num_bytes) == 0)
+               return count + i;
 
-      temp = temp->next;
-      count++;
+      return -1;
    }
 
+   temp = __ll_lookup(list, elem, &count);
+
    /* Element not found */
-   return -1;
+   if(!temp) return -1;
+
+   /* Found through the hash index; count the nodes before it */
+   if(count < 0)
+      for(count = 0; temp->prev; temp = temp->prev)
+         count++;
+
+   return count;
 }
 
 
@@ -383,11 +716,21 @@ int ll_indexof(llist_t* const list, void* const elem) {
  **/
 void ll_apply(llist_t* const list, void (*funct)(void* const)) {
    __node_t *temp;
+   __unode_t *un;
+   int i;
 
    if(!list) return;
 
    temp = list->__first;
 
+   if(list->__flags & LL_UNROLLED) {
+      for(un = list->__first; un; un = un->next)
+         for(i = 0; i < un->count; i++)
+            (funct)(__UELEM(un, i));
+
+      return;
+   }
+
    /* For each element in the list */
    while(temp) {
       (funct)(temp->element);
@@ -408,66 +751,15 @@ void ll_apply(llist_t* const list, void (*funct)(void* const)) {
  *    the size of the list.
  **/
 void* ll_rem(llist_t* const list, int index) {
-   __node_t *temp, *target;
-   void *result;
-   int count;
-
    if(!list) return NULL;
 
    if(index < 0 || index >= list->__size)
       return NULL;
 
-   /* Removing from empty list */
-   if(ll_empty(list)) return NULL;
-
-   target = NULL;
-
-   /* Removing from front of list */
-   if(index == 0) {
-      target = list->__first;
-      temp = target->next;
-
-      /* If there are more elements in the list */
-      if(temp)
-         temp->prev = NULL;
-      list->__first = temp;
-
-      /* There was only one element in the list to remove */
-      if(!temp)
-         list->__last = temp;
-   }
-
-   /* Remove from elsewhere in list */
-   else {
-      temp = list->__first;
-      count = 1;
-
-      /* Loop until temp is at the desired index */
-      while(temp->next) {
-         if(count == index) {
-            target = temp->next;
-
-            /* Target not at end of list */
-            if(target->next)
-               target->next->prev = temp;
-            temp->next = target->next;
-
-            break;
-         }
-
-         temp = temp->next;
-         count++;
-      }
-   }
-
-   temp = target->next;
+   if(list->__flags & LL_UNROLLED)
+      return __ul_rem(list, index);
 
-   /* Grab element, free containing node */
-   result = target->element;
-   free(target);
-
-   list->__size--;
-   return result;
+   return __ll_out(list, __ll_detach(list, index), NULL);
 }
 
 
@@ -496,210 +788,2753 @@ void* ll_reml(llist_t* const list) {
 
 
 /**
- * Replaces the element at the specified index with the specified element.
+ * Removes the element at the specified index in the specified list, copying
+ * its bytes into a buffer. On an inline list (see ll_init_inline(...)) this
+ * is the one copy out of the node. On any other list the element is copied
+ * from where it points, and is not freed.
  *
- * @param list - the list in which to replace the specified element.
- * @param index - specified index of the element to replace.
- * @param element - element to be stored at the specified index.
- * @return the element previously stored at the specified index.
+ * @param list - the list to remove the element from.
+ * @param index - the index of the element to be removed.
+ * @param out - a buffer of at least the list's element size.
+ * @return 1 if an element was removed. Returns 0 if either pointer is NULL
+ *    or the index is out of [0, size).
  **/
-void* ll_set(llist_t* const list, int index, void* const elem) {
-   __node_t *temp;
-   void *former;
-   int count;
+int ll_rem_into(llist_t* const list, int index, void* const out) {
+   void *elem;
 
-   if(!list) return NULL;
+   if(!list || !out) return 0;
 
    if(index < 0 || index >= list->__size)
-      return NULL;
-
-   temp = list->__first;
-   count = 0;
+      return 0;
 
-   /* Loop until desired index is found */
-   while(temp) {
-      if(count == index) {
-         former = temp->element;
-         temp->element = elem;
-
-         return former;
-      }
+   if(list->__flags & LL_UNROLLED) {
+      elem = __ul_rem(list, index);
+      memcpy(out, elem, list->__elem_size);
 
-      temp = temp->next;
-      count++;
+      return 1;
    }
 
-   /* Index not found */
-   return NULL;
+   __ll_out(list, __ll_detach(list, index), out);
+   return 1;
 }
 
 
 /**
- * Creates and returns a pointer to an array representation of the list.
- * Returns a pointer to an array on which free(...) may be called.
+ * Removes the first element in the specified list, copying it into a buffer.
+ * See ll_rem_into(...).
  *
- * @param list - the list to translate to an array.
- * @return a pointer to an array representation of the list.
+ * @param list - the list to remove the element from.
+ * @param out - a buffer of at least the list's element size.
+ * @return 1 if an element was removed. Returns 0 if either pointer is NULL
+ *    or the list is empty.
  **/
-void** ll_toarr(llist_t* const list) {
-   int** array;
-   int i, count;
-
-   if(!list) return NULL;
-
-   count = list->__size;
-
-   array = malloc(sizeof(void*) * count);
-
-   if(!array) return NULL;
-
-   /**
-    * TODO: has room for optimization
-    *
-    * Get the element at each position
-    **/
-   for(i = 0; i < count; i++)
-      array[i] = ll_get(list, i);
-
-   return (void**) array;
+int ll_remf_into(llist_t* const list, void* const out) {
+   return ll_rem_into(list, 0, out);
 }
 
 
-/** Linkedlist Iterator Functions */
-
 /**
- * A simulated constructor for a linkedlist iterator. Returns an iterator over
- * a specified linkedlist starting at a specified index.
+ * Removes the last element in the specified list, copying it into a buffer.
+ * See ll_rem_into(...).
  *
- * @param list - the list to return an iterator over.
- * @param index - the position that the iterator will start at.
- * @return an iterator over the specified linkedlist. Returns a NULL pointer
- *    if the specified list is NULL, (index < 0 || index >= ll_size(list)), or
- *    upon allocation error.
+ * @param list - the list to remove the element from.
+ * @param out - a buffer of at least the list's element size.
+ * @return 1 if an element was removed. Returns 0 if either pointer is NULL
+ *    or the list is empty.
  **/
-ll_itr_t* ll_itr(llist_t* const list, int index) {
-   ll_itr_t *iterator;
-   __node_t *temp;
-   int count;
+int ll_reml_into(llist_t* const list, void* const out) {
+   if(!list) return 0;
 
-   if(!list) return NULL;
+   return ll_rem_into(list, list->__size - 1, out);
+}
 
-   if(index < 0 || index >= list->__size)
-      return NULL;
 
-   iterator = malloc(sizeof(ll_itr_t));
+/**
+ * Unlink the node at a specified index of a list that is not unrolled,
+ * keeping the indexes and finger current.
+ *
+ * @param index - the index of the node; must be in [0, size).
+ * @return the unlinked node, to be released with __ll_out(...).
+ **/
+static void* __ll_detach(llist_t* const list, int index) {
+   __node_t *target;
 
-   if(!iterator) return NULL;
+   target = __ll_node(list, index);
 
-   temp = list->__first;
-   count = 0;
+   __sk_remove(list, target, index);
+   __ht_remove(list, target);
 
-   /* Loop to desired position */
-   while(temp) {
-      if(count == index) {
-         iterator->__next = temp;
-         iterator->__prev = temp->prev;
+   /* Unlink the node */
+   if(target->prev)
+      target->prev->next = target->next;
+   else
+      list->__first = target->next;
 
-         return iterator;
-      }
+   if(target->next)
+      target->next->prev = target->prev;
+   else
+      list->__last = target->prev;
 
-      temp = temp->next;
-      count++;
+   /* Keep the finger on a neighbour of the removed node */
+   if(target->next) {
+      list->__finger = target->next;
+      list->__fidx = index;
+   }
+   else {
+      list->__finger = target->prev;
+      list->__fidx = index - 1;
    }
 
-   /* Index not found */
-   return NULL;
+   list->__size--;
+   return target;
 }
 
 
 /**
- * A simulated destructor for a linkedlist iterator.
+ * Take the element of an unlinked node and release the node. The element of
+ * an inline list is copied out first, to the spare if there is no buffer.
  *
- * @param iterator - the iterator to destroy.
+ * @param node - the unlinked node.
+ * @param out - a buffer to copy the element into; may be NULL.
+ * @return the element: the buffer or spare copy if the list is inline, else
+ *    the pointer stored in the node.
  **/
-void li_free(ll_itr_t* const itr) {
-   free(itr);
+static void* __ll_out(llist_t* const list, void* const node, void* const out) {
+   void *result;
+
+   result = ((__node_t*) node)->element;
+
+   if(list->__flags & LL_INLINE)
+      result = memcpy((out ? out : list->__spare), result, list->__elem_size);
+   else if(out)
+      memcpy(out, result, list->__elem_size);
+
+   __ll_release(list, node);
+   return result;
 }
 
 
 /**
- * Indicates whether or not the iterator has more elements. In other words,
- * returns 1 if li_next(...) would return an element.
+ * Removes every element of the specified list for which a predicate holds,
+ * unlinking them in a single pass. Remaining elements keep their order.
  *
- * @param iterator - the iterator to check against for more elements.
- * @return 1 if there exists more elements in the iterator. Returns 0 if the
- *    iterator is NULL or does not have anymore elements.
+ * @param list - the list to remove elements from.
+ * @param pred - the predicate; called with an element and ctx, returns
+ *    nonzero if the element is to be removed.
+ * @param ctx - an argument passed through to the predicate; may be NULL.
+ * @param funct - a function applied to each removed element, such as
+ *    free(...); may be NULL.
+ * @return the number of elements removed. Returns 0 if the list or the
+ *    predicate is NULL.
  **/
-int li_hasnext(ll_itr_t* const itr) {
-   if(!itr) return !EXIST;
-
-   /* There exists another element */
-   return (itr->__next ? EXIST : !EXIST);
+int ll_remove_if(llist_t* const list, int (*pred)(void* const, void*),
+                 void* ctx, void (*funct)(void* const)) {
+   return __ll_filter(list, pred, ctx, funct, 0);
 }
 
 
 /**
- * Indicates whether or not the iterator has previous elements. In other words,
- * returns 1 if li_prev(...) would return an element.
+ * Removes every element of the specified list for which a predicate does
+ * not hold, in a single pass. The opposite of ll_remove_if(...).
  *
- * @param iterator - the iterator to check against for previous elements.
- * @return 1 if there exists a previous element in the iterator. Returns 0 if
- *    the iterator is NULL of does not have any previous elements.
+ * @param list - the list to remove elements from.
+ * @param pred - the predicate; called with an element and ctx, returns
+ *    nonzero if the element is to be kept.
+ * @param ctx - an argument passed through to the predicate; may be NULL.
+ * @param funct - a function applied to each removed element; may be NULL.
+ * @return the number of elements removed. Returns 0 if the list or the
+ *    predicate is NULL.
  **/
-int li_hasprev(ll_itr_t* const itr) {
-   if(!itr) return !EXIST;
-
-   /* There exists a previous element */
-   return (itr->__prev ? EXIST : !EXIST);
+int ll_retain(llist_t* const list, int (*pred)(void* const, void*),
+              void* ctx, void (*funct)(void* const)) {
+   return __ll_filter(list, pred, ctx, funct, 1);
 }
 
 
 /**
- * Retrieves (but does not remove) the next element in the iterator.
+ * Unlink every node of a list for which a predicate gives the specified
+ * answer.
+ *
+ * @param keep - nonzero to keep elements the predicate holds for, zero (0)
+ *    to remove them.
+ * @return the number of elements removed.
+ **/
+static int __ll_filter(llist_t* const list, int (*pred)(void* const, void*),
+                       void* ctx, void (*funct)(void* const), int keep) {
+   __node_t *temp, *next;
+   int removed;
+
+   if(!list || !pred) return 0;
+
+   if(list->__flags & LL_UNROLLED)
+      return __ul_filter(list, pred, ctx, funct, keep);
+
+   removed = 0;
+   list->__finger = NULL;  /* Indices are about to shift */
+   __sk_drop(list);
+   __ht_drop(list);
+
+   for(temp = list->__first; temp; temp = next) {
+      next = temp->next;
+
+      if(!pred(temp->element, ctx) == !keep)
+         continue;
+
+      /* Unlink the node */
+      if(temp->prev)
+         temp->prev->next = next;
+      else
+         list->__first = next;
+
+      if(next)
+         next->prev = temp->prev;
+      else
+         list->__last = temp->prev;
+
+      if(funct) (funct)(temp->element);
+
+      __ll_release(list, temp);
+      removed++;
+   }
+
+   list->__size -= removed;
+   return removed;
+}
+
+
+/**
+ * Replaces the element at the specified index with the specified element.
+ *
+ * @param list - the list in which to replace the specified element.
+ * @param index - specified index of the element to replace.
+ * @param element - element to be stored at the specified index.
+ * @return the element previously stored at the specified index.
+ **/
+void* ll_set(llist_t* const list, int index, void* const elem) {
+   __unode_t *un;
+
+   if(!list) return NULL;
+
+   if(index < 0 || index >= list->__size)
+      return NULL;
+
+   if((list->__flags & LL_INLINE) && !elem) return NULL;
+
+   if(list->__flags & LL_UNROLLED) {
+      un = __ul_node(list, &index);
+      return __ul_replace(list, un, index, elem);
+   }
+
+   return __ll_replace(list, __ll_node(list, index), elem);
+}
+
+
+/**
+ * Replace the element of a node of a list that is not unrolled, keeping the
+ * hash index current. The element of an inline list is copied over, after
+ * its former bytes are copied to the spare.
+ *
+ * @param node - the node whose element to replace.
+ * @param elem - the new element.
+ * @return the former element, or the spare copy of it if the list is
+ *    inline.
+ **/
+static void* __ll_replace(llist_t* const list, void* const node,
+                          void* const elem) {
+   __node_t *temp;
+   void *former;
+
+   temp = node;
+   __ht_remove(list, temp);
+
+   if(list->__flags & LL_INLINE) {
+      former = memcpy(list->__spare, temp->element, list->__elem_size);
+      memcpy(temp->element, elem, list->__elem_size);
+   }
+   else {
+      former = temp->element;
+      temp->element = elem;
+   }
+
+   __ht_insert(list, temp);
+
+   return former;
+}
+
+
+/**
+ * Removes the first occurrence of an element from the specified list,
+ * comparing elements by their bytes as ll_contains(...) does. With a hash
+ * index (see ll_hashindex(...)) this takes O(1) expected time, unless equal
+ * elements occur more than once.
+ *
+ * @param list - the list to remove the element from.
+ * @param elem - an element equal to the one to remove.
+ * @return the element removed from the list. Returns NULL if the list is NULL
+ *    or holds no equal element.
+ **/
+void* ll_remval(llist_t* const list, void* const elem) {
+   __node_t *node;
+   int index;
+
+   if(!list) return NULL;
+
+   if(list->__flags & LL_UNROLLED)
+      return ll_rem(list, ll_indexof(list, elem));
+
+   node = __ll_lookup(list, elem, &index);
+
+   if(!node) return NULL;
+
+   /* Its index is known; ll_rem(...) finds the node at the finger */
+   if(index >= 0) {
+      list->__finger = node;
+      list->__fidx = index;
+
+      return ll_rem(list, index);
+   }
+
+   /* Found through the hash index; only the skip list needs the index */
+   __sk_drop(list);
+   __ht_remove(list, node);
+   __ll_join(list, node->prev, node->next);
+
+   list->__finger = NULL;
+   list->__size--;
+
+   return __ll_out(list, node, NULL);
+}
+
+
+/**
+ * Moves the first occurrence of an element to the front of the specified
+ * list, comparing elements by their bytes. With a hash index (see
+ * ll_hashindex(...)) this takes O(1) expected time, which with ll_reml(...)
+ * makes the list a least-recently-used cache.
+ *
+ * @param list - the list to reorder.
+ * @param elem - an element equal to the one to move.
+ * @return 1 if the element was moved. Returns 0 if the list is NULL, holds
+ *    no equal element, or upon allocation error.
+ **/
+int ll_tofront(llist_t* const list, void* const elem) {
+   return __ll_toend(list, elem, 0);
+}
+
+
+/**
+ * Moves the first occurrence of an element to the end of the specified
+ * list. See ll_tofront(...).
+ *
+ * @param list - the list to reorder.
+ * @param elem - an element equal to the one to move.
+ * @return 1 if the element was moved. Returns 0 if the list is NULL, holds
+ *    no equal element, or upon allocation error.
+ **/
+int ll_toback(llist_t* const list, void* const elem) {
+   return __ll_toend(list, elem, 1);
+}
+
+
+/**
+ * Move the first occurrence of an element to either end of a list.
+ *
+ * @param back - nonzero to move the element to the end, zero (0) to the
+ *    front.
+ * @return 1 if the element was moved, else 0.
+ **/
+static int __ll_toend(llist_t* const list, void* const elem, int back) {
+   __node_t *node;
+   void *found;
+   int index, to;
+
+   if(!list) return !EXIST;
+
+   /* Add the element at the end first, so that failing changes nothing */
+   if(list->__flags & LL_UNROLLED) {
+      index = ll_indexof(list, elem);
+
+      if(index < 0) return !EXIST;
+
+      to = (back ? list->__size : 0);
+      found = ll_get(list, index);
+
+      /* Adding shifts inline slots; copy the element out of its slot */
+      if(list->__flags & LL_INLINE)
+         found = memcpy(list->__spare, found, list->__elem_size);
+
+      if(!ll_add(list, to, found)) return !EXIST;
+
+      ll_rem(list, (back ? index : index + 1));
+      return EXIST;
+   }
+
+   node = __ll_lookup(list, elem, &index);
+
+   if(!node) return !EXIST;
+
+   if(node == (back ? list->__last : list->__first))
+      return EXIST;
+
+   if(index >= 0)
+      __sk_remove(list, node, index);
+   else
+      __sk_drop(list);
+
+   __ll_join(list, node->prev, node->next);
+
+   if(back) {
+      __ll_join(list, list->__last, node);
+      __ll_join(list, node, NULL);
+   }
+   else {
+      __ll_join(list, node, list->__first);
+      __ll_join(list, NULL, node);
+   }
+
+   to = (back ? list->__size - 1 : 0);
+   __sk_insert(list, node, to);
+
+   list->__finger = node;
+   list->__fidx = to;
+
+   return EXIST;
+}
+
+
+/**
+ * Sorts the elements of a list with a stable, bottom-up merge sort in
+ * O(n log n) time. The nodes of the list are relinked in place without
+ * allocating; an unrolled list is sorted through a temporary array of its
+ * elements instead. Integer keys of up to 4 bytes ordered by LL_CMP_INT or
+ * LL_CMP_UINT are cached in their nodes and compared directly.
+ *
+ * @param list - the list to sort.
+ * @param cmp - the ordering to sort by. Either a function returning less
+ *    than, equal to, or greater than zero (0) as its first element is ordered
+ *    before, with, or after its second, or one of the built-in orderings:
+ *    LL_CMP_MEM (by bytes, as memcmp(...)), LL_CMP_INT (as signed integers)
+ *    or LL_CMP_UINT (as unsigned integers).
+ * @return 1 if the list was sorted. Returns 0 if the list is NULL or upon
+ *    allocation error.
+ **/
+int ll_sort(llist_t* const list, int (*cmp)(const void*, const void*)) {
+   __node_t *bins[SORT_BINS], *node, *next, *carry;
+   size_t width;
+   int i, keyed;
+
+   if(!list) return !ADDED;
+
+   if(list->__flags & LL_UNROLLED)
+      return __ul_sort(list, cmp);
+
+   width = list->__elem_size;
+   keyed = 0;
+
+   /* Small integer keys; cache each in its node's unused index field */
+   if((cmp == LL_CMP_INT || cmp == LL_CMP_UINT) &&
+      (width == 1 || width == 2 || width == 4)) {
+      for(node = list->__first; node; node = node->next) {
+         if(cmp == LL_CMP_UINT && width == 4)
+            node->index = (int) (*(uint32_t*) node->element - 0x80000000u);
+         else
+            node->index = (int) __ll_key(node->element, width,
+                                         cmp == LL_CMP_INT);
+      }
+
+      keyed = 1;
+   }
+
+   for(i = 0; i < SORT_BINS; i++)
+      bins[i] = NULL;
+
+   /**
+    * Merge each node into the bins like a binary counter; bin i holds a
+    * sorted run of 2^i nodes that came before anything in lower bins.
+    **/
+   for(node = list->__first; node; node = next) {
+      next = node->next;
+      node->next = NULL;
+      carry = node;
+
+      for(i = 0; i < SORT_BINS - 1 && bins[i]; i++) {
+         carry = __ll_merge(bins[i], carry, cmp, width, keyed);
+         bins[i] = NULL;
+      }
+
+      bins[i] = carry;
+   }
+
+   /* Gather the runs, earliest last */
+   carry = NULL;
+
+   for(i = 0; i < SORT_BINS; i++)
+      if(bins[i])
+         carry = __ll_merge(bins[i], carry, cmp, width, keyed);
+
+   /* Restore the back links */
+   list->__first = carry;
+   list->__last = NULL;
+
+   for(node = carry; node; node = node->next) {
+      node->prev = list->__last;
+      list->__last = node;
+   }
+
+   list->__finger = NULL;
+   __sk_drop(list);
+
+   return ADDED;
+}
+
+
+/**
+ * Moves every element of one list into another at a specified index,
+ * leaving the source list empty. Nodes are relinked rather than copied, and
+ * the move itself is O(1) once the index is found: either both lists share a
+ * pool (see ll_setpool(...)), or the source's private pool is merged into
+ * the destination's. Lists of different kinds, or a source whose shared pool
+ * is not the destination's, have their elements moved one at a time instead.
+ * The skip list index of an indexed destination is rebuilt on next use.
+ *
+ * @param dst - the list to move the elements into.
+ * @param index - the index in dst the first element of src is moved to.
+ * @param src - the list to move the elements out of.
+ * @return 1 if the elements were moved. Returns 0 if either list is NULL,
+ *    both are the same list, the element sizes differ, only one list is
+ *    inline, the index is out of [0, ll_size(dst)], or upon allocation
+ *    error.
+ **/
+int ll_splice(llist_t* const dst, int index, llist_t* const src) {
+   void *before, *after;
+
+   if(!dst || !src || dst == src) return !ADDED;
+
+   if(dst->__elem_size != src->__elem_size) return !ADDED;
+
+   /* Copies and pointers do not mix */
+   if((dst->__flags & LL_INLINE) != (src->__flags & LL_INLINE))
+      return !ADDED;
+
+   if(index < 0 || index > dst->__size)
+      return !ADDED;
+
+   if(!src->__size) return ADDED;
+
+   /* Nodes cannot move between these lists; move the elements */
+   if((dst->__flags & LL_UNROLLED) != (src->__flags & LL_UNROLLED) ||
+      dst->__per_node != src->__per_node) {
+      return __ll_move(dst, index, src);
+   }
+
+   /* Find the nodes either side of the gap */
+   if(dst->__flags & LL_UNROLLED) {
+      if(!__ul_cut(dst, index, &before)) return !ADDED;
+
+      after = (before ? ((__unode_t*) before)->prev : dst->__last);
+   }
+   else {
+      before = (index < dst->__size ? __ll_node(dst, index) : NULL);
+      after = (before ? ((__node_t*) before)->prev : dst->__last);
+   }
+
+   if(!__ll_adopt(dst, src)) {
+      return __ll_move(dst, index, src);
+   }
+
+   __ll_join(dst, after, src->__first);
+   __ll_join(dst, src->__last, before);
+
+   dst->__size += src->__size;
+   dst->__finger = src->__first;
+   dst->__fidx = index;
+   __sk_drop(dst);
+   __ht_drop(dst);
+
+   src->__first = NULL;
+   src->__last = NULL;
+   src->__size = 0;
+   src->__finger = NULL;
+   __sk_drop(src);
+   __ht_drop(src);
+
+   return ADDED;
+}
+
+
+/**
+ * Moves every element of one list onto the end of another, leaving the
+ * source list empty. See ll_splice(...).
+ *
+ * @param dst - the list to append the elements to.
+ * @param src - the list to move the elements out of.
+ * @return 1 if the elements were moved. Returns 0 under the same conditions
+ *    as ll_splice(...).
+ **/
+int ll_concat(llist_t* const dst, llist_t* const src) {
+   if(!dst) return !ADDED;
+
+   return ll_splice(dst, dst->__size, src);
+}
+
+
+/**
+ * Moves a range of elements out of a list into a new list of the same kind.
+ * Nodes are relinked rather than copied, and the new list shares the pool of
+ * the original, so only finding the ends of the range costs more than O(1).
+ *
+ * @param list - the list to take the elements from.
+ * @param from - the index of the first element to move.
+ * @param to - the index after the last element to move.
+ * @return a new list holding the elements in [from, to). Returns a NULL
+ *    pointer if the list is NULL, (from < 0 || from > to || to > size), or
+ *    upon allocation error.
+ **/
+llist_t* ll_sub(llist_t* const list, int from, int to) {
+   llist_t *sub;
+   void *first, *last, *end;
+
+   if(!list) return NULL;
+
+   if(from < 0 || from > to || to > list->__size)
+      return NULL;
+
+   sub = __ll_create(list->__elem_size, list->__flags, list->__per_node);
+
+   if(!sub) return NULL;
+
+   if(from == to) return sub;
+
+   /* Find the first and last nodes of the range */
+   if(list->__flags & LL_UNROLLED) {
+      if(!__ul_cut(list, from, &first) || !__ul_cut(list, to, &end)) {
+         ll_free(sub);
+         return NULL;
+      }
+
+      last = (end ? ((__unode_t*) end)->prev : list->__last);
+   }
+   else {
+      first = __ll_node(list, from);
+      last = __ll_node(list, to - 1);
+      end = ((__node_t*) last)->next;
+   }
+
+   /* Both lists now hold nodes of the pool */
+   sub->__pool = list->__pool;
+   sub->__pool->__refs++;
+
+   /* Close the gap, then bound the range */
+   __ll_join(list, (list->__flags & LL_UNROLLED ?
+                    (void*) ((__unode_t*) first)->prev :
+                    (void*) ((__node_t*) first)->prev), end);
+   __ll_join(sub, NULL, first);
+   __ll_join(sub, last, NULL);
+
+   list->__size -= to - from;
+   list->__finger = NULL;
+   __sk_drop(list);
+   __ht_drop(list);
+
+   sub->__size = to - from;
+
+   return sub;
+}
+
+
+/**
+ * Moves the nodes of a list into one contiguous block, in traversal order,
+ * so that walking the list touches memory sequentially. The nodes of an
+ * unrolled list are also packed full. With a private pool the memory of the
+ * old nodes is returned; with a shared pool they go to its free list. Every
+ * node moves, so cursors and iterators over the list are invalidated.
+ *
+ * @param list - the list to compact.
+ * @return 1 if the list was compacted. Returns 0 if the list is NULL or upon
+ *    allocation error.
+ **/
+int ll_compact(llist_t* const list) {
+   ll_pool_t *pool;
+   __node_t *node, *next, *block;
+   __unode_t *un, *unext, *ublock;
+   void *chunks;
+   size_t size;
+   int i, j, n, slot;
+
+   if(!list) return !ADDED;
+
+   if(!list->__size) return ADDED;
+
+   pool = list->__pool;
+   size = list->__node_size;
+
+   n = list->__size;
+
+   if(list->__flags & LL_UNROLLED)
+      n = (n + list->__per_node - 1) / list->__per_node;
+
+   /* Keep the old chunks of a private pool apart, to free them after */
+   chunks = pool->__chunks;
+
+   if(!__SHARED(pool))
+      pool->__chunks = NULL;
+
+   block = __ll_chunk(pool, n);
+
+   if(!block) {
+      if(!__SHARED(pool))
+         pool->__chunks = chunks;
+
+      return !ADDED;
+   }
+
+   ublock = (__unode_t*) block;
+
+   /* Copy the nodes across in order, linking each to its neighbours */
+   if(list->__flags & LL_UNROLLED) {
+      for(i = 0; i < n; i++)
+         ((__unode_t*) ((char*) ublock + i * size))->width =
+            (list->__flags & LL_INLINE ? (int) list->__elem_size : 0);
+
+      i = 0;
+      slot = 0;
+
+      /* Pack the elements into full nodes */
+      for(un = list->__first; un; un = unext) {
+         unext = un->next;
+
+         for(j = 0; j < un->count; j++) {
+            if(slot == list->__per_node) {
+               i++;
+               slot = 0;
+            }
+
+            memcpy(__USLOT((__unode_t*) ((char*) ublock + i * size), slot++),
+                   __USLOT(un, j), __USIZE(list));
+         }
+
+         if(__SHARED(pool)) __ll_release(list, un);
+      }
+
+      for(i = 0; i < n; i++) {
+         un = (__unode_t*) ((char*) ublock + i * size);
+         un->count = (i < n - 1 ? list->__per_node : slot);
+         un->prev = (i ? (__unode_t*) ((char*) un - size) : NULL);
+         un->next = (i < n - 1 ? (__unode_t*) ((char*) un + size) : NULL);
+      }
+
+      list->__last = (char*) ublock + (n - 1) * size;
+   }
+   else {
+      for(i = 0, node = list->__first; node; i++, node = next) {
+         next = node->next;
+
+         block = (__node_t*) ((char*) ublock + i * size);
+
+         if(list->__flags & LL_INLINE)
+            block->element = memcpy(__INLINE(block), node->element,
+                                    list->__elem_size);
+         else
+            block->element = node->element;
+
+         block->index = node->index;
+         block->prev = (i ? (__node_t*) ((char*) block - size) : NULL);
+         block->next = (next ? (__node_t*) ((char*) block + size) : NULL);
+
+         if(__SHARED(pool)) __ll_release(list, node);
+      }
+
+      list->__last = block;
+   }
+
+   list->__first = ublock;
+
+   /* A private pool held only this list's nodes; free its old chunks */
+   if(!__SHARED(pool)) {
+      __ll_unchunk(chunks);
+
+      pool->__free = NULL;
+      pool->__bump = NULL;
+      pool->__end = NULL;
+   }
+
+   list->__finger = NULL;
+   list->__churn = 0;
+   __sk_drop(list);
+   __ht_drop(list);
+
+   return ADDED;
+}
+
+
+/**
+ * Measures how scattered the nodes of a list are: the percentage of links
+ * from one node to the next that do not lead to the adjacent node in
+ * memory. A freshly compacted list measures 0 (zero). Takes O(n) time.
+ *
+ * @param list - the list to measure.
+ * @return the percentage, from 0 to 100. Returns -1 if the list is NULL.
+ **/
+int ll_fragmentation(llist_t* const list) {
+   char *node, *next;
+   int links, jumps;
+
+   if(!list) return -1;
+
+   links = 0;
+   jumps = 0;
+
+   for(node = list->__first; node; node = next) {
+      if(list->__flags & LL_UNROLLED)
+         next = (char*) ((__unode_t*) node)->next;
+      else
+         next = (char*) ((__node_t*) node)->next;
+
+      if(!next) break;
+
+      links++;
+
+      if(next != node + list->__node_size)
+         jumps++;
+   }
+
+   return (links ? (int) ((long) jumps * 100 / links) : 0);
+}
+
+
+/**
+ * Makes a list compact itself with ll_compact(...) whenever it grows after
+ * enough churn: once the nodes released since the last compaction exceed a
+ * percentage of the list's size. Each compaction is paid for by that many
+ * earlier removals, so the amortized cost per operation stays O(1). Any
+ * ll_add(...) may then move every node, invalidating cursors and iterators.
+ *
+ * @param list - the list to compact automatically.
+ * @param percent - the threshold; 0 (zero) turns automatic compaction off.
+ **/
+void ll_autocompact(llist_t* const list, int percent) {
+   if(!list) return;
+
+   list->__autocompact = (percent > 0 ? percent : 0);
+   list->__churn = 0;
+}
+
+
+/**
+ * Compact a list if it is set to compact automatically and has passed its
+ * threshold.
+ **/
+static void __ll_check_compact(llist_t* const list) {
+   if(!list->__autocompact || list->__size < COMPACT_MIN)
+      return;
+
+   if((long) list->__churn * 100 > (long) list->__autocompact * list->__size)
+      ll_compact(list);
+}
+
+
+/**
+ * Creates and returns a pointer to an array representation of the list.
+ * Returns a pointer to an array on which free(...) may be called.
+ *
+ * @param list - the list to translate to an array.
+ * @return a pointer to an array representation of the list.
+ **/
+void** ll_toarr(llist_t* const list) {
+   void **array;
+   __node_t *temp;
+   __unode_t *un;
+   int i, j;
+
+   if(!list) return NULL;
+
+   array = malloc(sizeof(void*) * list->__size);
+
+   if(!array) return NULL;
+
+   if(list->__flags & LL_UNROLLED) {
+      for(i = 0, un = list->__first; un; un = un->next)
+         for(j = 0; j < un->count; j++)
+            array[i++] = __UELEM(un, j);
+
+      return array;
+   }
+
+   /* Copy each element in a single walk */
+   for(i = 0, temp = list->__first; temp; i++, temp = temp->next)
+      array[i] = temp->element;
+
+   return array;
+}
+
+
+/**
+ * Find the node at a specified index, walking from whichever of the first
+ * node, the last node or the finger is closest. The node found becomes the
+ * new finger, so sequential and nearby indexed access is O(1) amortized.
+ *
+ * @param index - the index of the node; must be in [0, size).
+ * @return the node at the specified index.
+ **/
+static void* __ll_node(llist_t* const list, int index) {
+   __node_t *temp;
+   int pos, dist;
+
+   /* Start at whichever end is closer */
+   if(index < list->__size - 1 - index) {
+      temp = list->__first;
+      pos = 0;
+      dist = index;
+   }
+   else {
+      temp = list->__last;
+      pos = list->__size - 1;
+      dist = pos - index;
+   }
+
+   /* The finger may be closer still */
+   if(list->__finger) {
+      if(abs(index - list->__fidx) < dist) {
+         temp = list->__finger;
+         pos = list->__fidx;
+         dist = abs(index - pos);
+      }
+   }
+
+   /* Long walks go through the index, built here if need be */
+   if(dist > SKIP_WALK && (list->__flags & LL_INDEXED)) {
+      if(list->__skip || __sk_build(list)) {
+         temp = __sk_find(list, index);
+         pos = index;
+      }
+   }
+
+   for(; pos < index; pos++)
+      temp = temp->next;
+   for(; pos > index; pos--)
+      temp = temp->prev;
+
+   list->__finger = temp;
+   list->__fidx = index;
+
+   return temp;
+}
+
+
+/**
+ * Find the first node of a list whose element equals a specified one, by
+ * the hash index if the list has one. Not for unrolled lists.
+ *
+ * @param index - set to the index of the node found, or to -1 if it was
+ *    found through the hash index and its index is unknown.
+ * @return the node found. Returns NULL if no element is equal.
+ **/
+static void* __ll_lookup(llist_t* const list, void* const elem,
+                         int* const index) {
+   __node_t *temp;
+   int dups;
+
+   /* A single match is the first; duplicates need the walk */
+   if(__ht_ready(list)) {
+      temp = __ht_find(list, elem, &dups);
+
+      if(!temp || !dups) {
+         *index = -1;
+         return temp;
+      }
+   }
+
+   for(temp = list->__first, *index = 0; temp; temp = temp->next, (*index)++)
+      if(memcmp(elem, temp->element, list->__elem_size) == 0)
+         return temp;
+
+   return NULL;
+}
+
+
+/**
+ * Link two nodes of a list as neighbours.
+ *
+ * @param a - the node to come first; NULL to make b the first node.
+ * @param b - the node to come second; NULL to make a the last node.
+ **/
+static void __ll_join(llist_t* const list, void* const a, void* const b) {
+   if(list->__flags & LL_UNROLLED) {
+      if(a) ((__unode_t*) a)->next = b;
+      if(b) ((__unode_t*) b)->prev = a;
+   }
+   else {
+      if(a) ((__node_t*) a)->next = b;
+      if(b) ((__node_t*) b)->prev = a;
+   }
+
+   if(!a) list->__first = b;
+   if(!b) list->__last = a;
+}
+
+
+/**
+ * Make the nodes of a non-empty list safe to relink into another: lists
+ * sharing a pool need nothing, and a private pool of the source is handed
+ * to or merged into the pool of the destination.
+ *
+ * @param dst - the list the nodes are moving to.
+ * @param src - the list the nodes are moving from.
+ * @return 1 if the nodes may be relinked. Returns 0 if the source's pool is
+ *    shared with other lists.
+ **/
+static int __ll_adopt(llist_t* const dst, llist_t* const src) {
+   ll_pool_t *from, *into;
+
+   from = src->__pool;
+   into = dst->__pool;
+
+   if(from == into) return 1;
+
+   if(__SHARED(from)) return 0;
+
+   /* The destination has yet to allocate; hand it the whole pool */
+   if(!into) {
+      dst->__pool = from;
+      src->__pool = NULL;
+
+      return 1;
+   }
+
+   /* Chain the chunks and free nodes of the private pool onto the other */
+   if(from->__chunks) {
+      *(void**) from->__clast = into->__chunks;
+
+      if(!into->__chunks)
+         into->__clast = from->__clast;
+
+      into->__chunks = from->__chunks;
+   }
+
+   if(from->__free) {
+      *(void**) from->__flast = into->__free;
+
+      if(!into->__free)
+         into->__flast = from->__flast;
+
+      into->__free = from->__free;
+   }
+
+   free(from);
+   src->__pool = NULL;
+
+   return 1;
+}
+
+
+/**
+ * Move the elements of one list into another one at a time, for lists whose
+ * nodes cannot be relinked between them.
+ *
+ * @return 1 if the elements were moved. Returns 0 upon allocation error.
+ **/
+static int __ll_move(llist_t* const dst, int index, llist_t* const src) {
+   for(; src->__size; index++) {
+      if(!ll_add(dst, index, ll_first(src)))
+         return !ADDED;
+
+      ll_remf(src);
+   }
+
+   return ADDED;
+}
+
+
+/**
+ * Read an integer element as a 64-bit key that orders as the integer does.
+ *
+ * @param elem - the element.
+ * @param width - the size of the element (1, 2, 4 or 8).
+ * @param is_signed - nonzero if the element is signed.
+ * @return the key.
+ **/
+static int64_t __ll_key(const void* elem, size_t width, int is_signed) {
+   int64_t key;
+   uint64_t u;
+
+   switch(width) {
+      case 1:
+         return (is_signed ? (int64_t) *(const signed char*) elem :
+                             (int64_t) *(const unsigned char*) elem);
+      case 2:
+         return (is_signed ? (int64_t) *(const int16_t*) elem :
+                             (int64_t) *(const uint16_t*) elem);
+      case 4:
+         return (is_signed ? (int64_t) *(const int32_t*) elem :
+                             (int64_t) *(const uint32_t*) elem);
+   }
+
+   if(is_signed) {
+      memcpy(&key, elem, 8);
+      return key;
+   }
+
+   /* Flip the sign bit so unsigned order survives as signed */
+   memcpy(&u, elem, 8);
+   return (int64_t) (u ^ ((uint64_t) 1 << 63));
+}
+
+
+/**
+ * Compare two elements with an ordering, which may be one of the built-in
+ * orderings LL_CMP_MEM, LL_CMP_INT or LL_CMP_UINT.
+ *
+ * @param width - the size of an element.
+ * @return less than, equal to, or greater than zero (0) as a is ordered
+ *    before, with, or after b.
+ **/
+static int __ll_order(int (*cmp)(const void*, const void*), size_t width,
+                      const void* a, const void* b) {
+   int64_t ka, kb;
+
+   if((cmp == LL_CMP_INT || cmp == LL_CMP_UINT) &&
+      (width == 1 || width == 2 || width == 4 || width == 8)) {
+      ka = __ll_key(a, width, cmp == LL_CMP_INT);
+      kb = __ll_key(b, width, cmp == LL_CMP_INT);
+
+      return (ka > kb) - (ka < kb);
+   }
+
+   if(cmp == LL_CMP_MEM || cmp == LL_CMP_INT || cmp == LL_CMP_UINT)
+      return memcmp(a, b, width);
+
+   return (cmp)(a, b);
+}
+
+
+/**
+ * Merge two sorted runs of nodes, linked through next and NULL-terminated,
+ * into one. Ties are taken from the first run, keeping the merge stable.
+ *
+ * @param a - the run whose nodes came first.
+ * @param b - the run whose nodes came second.
+ * @param cmp - the ordering, used unless keyed.
+ * @param keyed - nonzero to compare the keys cached in the nodes instead.
+ * @return the merged run.
+ **/
+static void* __ll_merge(void* a, void* b,
+                        int (*cmp)(const void*, const void*), size_t width,
+                        int keyed) {
+   __node_t head, *tail, *x, *y;
+
+   tail = &head;
+   x = a;
+   y = b;
+
+   if(keyed) {
+      while(x && y) {
+         if(x->index <= y->index) {
+            tail->next = x;
+            x = x->next;
+         }
+         else {
+            tail->next = y;
+            y = y->next;
+         }
+
+         tail = tail->next;
+      }
+   }
+   else {
+      while(x && y) {
+         if(__ll_order(cmp, width, x->element, y->element) <= 0) {
+            tail->next = x;
+            x = x->next;
+         }
+         else {
+            tail->next = y;
+            y = y->next;
+         }
+
+         tail = tail->next;
+      }
+   }
+
+   tail->next = (x ? x : y);
+   return head.next;
+}
+
+
+/** Unrolled Linkedlist Functions */
+
+/**
+ * Find the node of an unrolled list holding a specified index, walking from
+ * whichever of the first node, the last node or the finger is closest. The
+ * node found becomes the new finger; the finger index of an unrolled list is
+ * that of the first element in the finger node.
+ *
+ * @param index - the index of the element, which must be in [0, size); set
+ *    to the slot of the element within the node found.
+ * @return the node holding the element.
+ **/
+static void* __ul_node(llist_t* const list, int* const index) {
+   __unode_t *temp;
+   int pos, dist;
+
+   /* Start at whichever end is closer */
+   if(*index < list->__size - 1 - *index) {
+      temp = list->__first;
+      pos = 0;
+      dist = *index;
+   }
+   else {
+      temp = list->__last;
+      pos = list->__size - temp->count;
+      dist = list->__size - 1 - *index;
+   }
+
+   /* The finger may be closer still */
+   if(list->__finger) {
+      if(abs(*index - list->__fidx) < dist) {
+         temp = list->__finger;
+         pos = list->__fidx;
+      }
+   }
+
+   while(*index < pos) {
+      temp = temp->prev;
+      pos -= temp->count;
+   }
+
+   while(*index >= pos + temp->count) {
+      pos += temp->count;
+      temp = temp->next;
+   }
+
+   list->__finger = temp;
+   list->__fidx = pos;
+
+   *index -= pos;
+   return temp;
+}
+
+
+/**
+ * Link a new, empty node into an unrolled list after a specified node.
+ *
+ * @param prev - the node to link after; NULL to link at the front.
+ * @return the new node. Returns NULL upon allocation error.
+ **/
+static __unode_t* __ul_link(llist_t* const list, __unode_t* const prev) {
+   __unode_t *new;
+
+   new = __ll_alloc(list);
+
+   if(!new) return NULL;
+
+   new->count = 0;
+   new->width = (list->__flags & LL_INLINE ? (int) list->__elem_size : 0);
+   new->prev = prev;
+   new->next = (prev ? prev->next : list->__first);
+
+   if(new->next)
+      new->next->prev = new;
+   else
+      list->__last = new;
+
+   if(prev)
+      prev->next = new;
+   else
+      list->__first = new;
+
+   return new;
+}
+
+
+/**
+ * Unlink a node from an unrolled list and return it to the pool.
+ *
+ * @param node - the node to unlink.
+ **/
+static void __ul_unlink(llist_t* const list, __unode_t* const node) {
+   if(node->prev)
+      node->prev->next = node->next;
+   else
+      list->__first = node->next;
+
+   if(node->next)
+      node->next->prev = node->prev;
+   else
+      list->__last = node->prev;
+
+   __ll_release(list, node);
+}
+
+
+/**
+ * Add an element to an unrolled list. A full node is split in half, except
+ * at either end of the list where a fresh node is started instead, so lists
+ * built by appending or prepending stay fully packed.
+ *
+ * @param index - the index to insert at; must be in [0, size].
+ * @return 1 if the element is added. Returns 0 upon allocation error.
+ **/
+static int __ul_add(llist_t* const list, int index, void* const elem) {
+   __unode_t *node, *new;
+   size_t size;
+   int slot, pos, half;
+
+   size = __USIZE(list);
+
+   /* Find the node and slot to insert at */
+   if(!list->__size) {
+      node = __ul_link(list, NULL);
+
+      if(!node) return !ADDED;
+
+      slot = 0;
+   }
+   else if(index == list->__size) {
+      node = list->__last;
+      slot = node->count;
+   }
+   else {
+      slot = index;
+      node = __ul_node(list, &slot);
+   }
+
+   pos = index - slot;
+
+   /* No room in the node */
+   if(node->count == list->__per_node) {
+      if(slot == node->count && !node->next) {
+         node = __ul_link(list, node);
+         pos = index;
+         slot = 0;
+      }
+      else if(slot == 0 && !node->prev) {
+         node = __ul_link(list, NULL);
+         slot = 0;
+      }
+      else {
+         new = __ul_link(list, node);
+
+         if(!new) return !ADDED;
+
+         /* Move the upper half of the node into the new one */
+         half = node->count / 2;
+         new->count = node->count - half;
+         node->count = half;
+         memcpy(new->elems, __USLOT(node, half), new->count * size);
+
+         if(slot > half) {
+            node = new;
+            slot -= half;
+            pos += half;
+         }
+      }
+
+      if(!node) return !ADDED;
+   }
+
+   memmove(__USLOT(node, slot + 1), __USLOT(node, slot),
+           (node->count - slot) * size);
+
+   if(list->__flags & LL_INLINE)
+      memcpy(__USLOT(node, slot), elem, size);
+   else
+      *(void**) __USLOT(node, slot) = elem;
+
+   node->count++;
+
+   list->__finger = node;
+   list->__fidx = pos;
+
+   list->__size++;
+   return ADDED;
+}
+
+
+/**
+ * Remove an element from an unrolled list. A node left less than half full
+ * is merged with a neighbour when their elements fit in one node.
+ *
+ * @param index - the index to remove; must be in [0, size).
+ * @return the element removed; its copy in the spare if the list is inline.
+ **/
+static void* __ul_rem(llist_t* const list, int index) {
+   __unode_t *node, *other;
+   void *result;
+   size_t size;
+   int slot, pos;
+
+   size = __USIZE(list);
+
+   slot = index;
+   node = __ul_node(list, &slot);
+   pos = index - slot;
+
+   result = __UELEM(node, slot);
+
+   if(list->__flags & LL_INLINE)
+      result = memcpy(list->__spare, result, size);
+
+   node->count--;
+   memmove(__USLOT(node, slot), __USLOT(node, slot + 1),
+           (node->count - slot) * size);
+
+   list->__finger = node;
+   list->__fidx = pos;
+
+   /* Drop an empty node, keeping the finger on a neighbour */
+   if(!node->count) {
+      if(node->next) {
+         list->__finger = node->next;
+      }
+      else {
+         list->__finger = node->prev;
+
+         if(node->prev)
+            list->__fidx = pos - node->prev->count;
+      }
+
+      __ul_unlink(list, node);
+   }
+
+   /* Merge a sparse node with a neighbour */
+   else if(node->count < list->__per_node / 2) {
+      other = node->next;
+
+      if(other && node->count + other->count <= list->__per_node) {
+         memcpy(__USLOT(node, node->count), other->elems,
+                other->count * size);
+         node->count += other->count;
+
+         __ul_unlink(list, other);
+      }
+      else if((other = node->prev) &&
+              node->count + other->count <= list->__per_node) {
+         memcpy(__USLOT(other, other->count), node->elems,
+                node->count * size);
+
+         list->__finger = other;
+         list->__fidx = pos - other->count;
+
+         other->count += node->count;
+
+         __ul_unlink(list, node);
+      }
+   }
+
+   list->__size--;
+   return result;
+}
+
+
+/**
+ * Unrolled counterpart of __ll_replace(...).
+ *
+ * @param node - the node holding the element to replace.
+ * @param slot - the slot of the element within the node.
+ * @return the former element; its copy in the spare if the list is inline.
+ **/
+static void* __ul_replace(llist_t* const list, void* const node, int slot,
+                          void* const elem) {
+   __unode_t *un;
+   void *former;
+
+   un = node;
+   former = __UELEM(un, slot);
+
+   if(list->__flags & LL_INLINE) {
+      former = memcpy(list->__spare, former, list->__elem_size);
+      memcpy(__USLOT(un, slot), elem, list->__elem_size);
+   }
+   else
+      *(void**) __USLOT(un, slot) = elem;
+
+   return former;
+}
+
+
+/**
+ * Unrolled counterpart of __ll_filter(...). Kept elements are packed towards
+ * the front of the list and emptied nodes are released.
+ *
+ * @return the number of elements removed.
+ **/
+static int __ul_filter(llist_t* const list, int (*pred)(void* const, void*),
+                       void* ctx, void (*funct)(void* const), int keep) {
+   __unode_t *read, *write, *next;
+   void *elem;
+   size_t size;
+   int i, slot, removed;
+
+   size = __USIZE(list);
+   removed = 0;
+   list->__finger = NULL;
+
+   write = list->__first;
+   slot = 0;
+
+   for(read = list->__first; read; read = read->next) {
+      for(i = 0; i < read->count; i++) {
+         elem = __UELEM(read, i);
+
+         if(!pred(elem, ctx) == !keep) {
+            /* The write position never passes the read position */
+            if(slot == list->__per_node) {
+               write->count = slot;
+               write = write->next;
+               slot = 0;
+            }
+
+            /* The slots may be one and the same */
+            memmove(__USLOT(write, slot), __USLOT(read, i), size);
+            slot++;
+            continue;
+         }
+
+         if(funct) (funct)(elem);
+         removed++;
+      }
+   }
+
+   /* Release the nodes past the last one written */
+   if(write) {
+      write->count = slot;
+
+      for(read = (slot ? write->next : write); read; read = next) {
+         next = read->next;
+         __ul_unlink(list, read);
+      }
+   }
+
+   list->__size -= removed;
+   return removed;
+}
+
+
+/**
+ * Unrolled counterpart of ll_sort(...). The elements are gathered into an
+ * array, merge sorted bottom-up against a second array, and written back
+ * into the nodes in order. An inline list sorts pointers to its slots, then
+ * gathers the bytes in sorted order and copies them back.
+ *
+ * @return 1 if the list was sorted. Returns 0 upon allocation error.
+ **/
+static int __ul_sort(llist_t* const list,
+                     int (*cmp)(const void*, const void*)) {
+   __unode_t *un;
+   void **src, **dst, **tmp;
+   char *bytes;
+   size_t width;
+   int n, run, lo, mid, hi, i, j, k;
+
+   n = list->__size;
+   width = list->__elem_size;
+
+   if(n < 2) return ADDED;
+
+   src = malloc(2 * n * sizeof(void*));
+
+   if(!src) return !ADDED;
+
+   bytes = NULL;
+
+   if(list->__flags & LL_INLINE) {
+      bytes = malloc(n * width);
+
+      if(!bytes) {
+         free(src);
+         return !ADDED;
+      }
+   }
+
+   dst = src + n;
+
+   for(i = 0, un = list->__first; un; un = un->next)
+      for(j = 0; j < un->count; j++)
+         src[i++] = __UELEM(un, j);
+
+   /* Merge runs of doubling length from one array into the other */
+   for(run = 1; run < n; run *= 2) {
+      for(lo = 0; lo < n; lo = hi) {
+         mid = (lo + run < n ? lo + run : n);
+         hi = (mid + run < n ? mid + run : n);
+
+         for(i = lo, j = mid, k = lo; k < hi; k++) {
+            if(j >= hi ||
+               (i < mid && __ll_order(cmp, width, src[i], src[j]) <= 0))
+               dst[k] = src[i++];
+            else
+               dst[k] = src[j++];
+         }
+      }
+
+      tmp = src;
+      src = dst;
+      dst = tmp;
+   }
+
+   if(bytes) {
+      for(i = 0; i < n; i++)
+         memcpy(bytes + i * width, src[i], width);
+
+      for(i = 0, un = list->__first; un; i += un->count, un = un->next)
+         memcpy(un->elems, bytes + i * width, un->count * width);
+
+      free(bytes);
+   }
+   else {
+      for(i = 0, un = list->__first; un; i += un->count, un = un->next)
+         memcpy(un->elems, src + i, un->count * sizeof(void*));
+   }
+
+   free(src < dst ? src : dst);
+   return ADDED;
+}
+
+
+/**
+ * Make a specified index of an unrolled list start a node, splitting the
+ * node holding it if need be.
+ *
+ * @param index - the index; must be in [0, size].
+ * @param node - set to the node starting at index, or NULL if index is the
+ *    size of the list.
+ * @return 1 on success. Returns 0 upon allocation error.
+ **/
+static int __ul_cut(llist_t* const list, int index, void** const node) {
+   __unode_t *temp, *new;
+   int slot;
+
+   *node = NULL;
+
+   if(index == list->__size) return 1;
+
+   slot = index;
+   temp = __ul_node(list, &slot);
+
+   if(slot) {
+      new = __ul_link(list, temp);
+
+      if(!new) return 0;
+
+      new->count = temp->count - slot;
+      temp->count = slot;
+      memcpy(new->elems, __USLOT(temp, slot), new->count * __USIZE(list));
+
+      temp = new;
+   }
+
+   *node = temp;
+   return 1;
+}
+
+
+/**
+ * Return the element at a position in an unrolled list and step the
+ * position forward.
+ *
+ * @param node - the node of the position; NULL once past the last element.
+ * @param slot - the slot of the position within the node.
+ * @return the element at the position.
+ **/
+static void* __ul_next(void** const node, int* const slot) {
+   __unode_t *temp;
+   void *elem;
+
+   temp = *node;
+   elem = __UELEM(temp, *slot);
+
+   if(++*slot == temp->count) {
+      *node = temp->next;
+      *slot = 0;
+   }
+
+   return elem;
+}
+
+
+/**
+ * Return the element at a position in an unrolled list and step the
+ * position back.
+ *
+ * @param node - the node of the position; NULL once before the first element.
+ * @param slot - the slot of the position within the node.
+ * @return the element at the position.
+ **/
+static void* __ul_prev(void** const node, int* const slot) {
+   __unode_t *temp;
+   void *elem;
+
+   temp = *node;
+   elem = __UELEM(temp, *slot);
+
+   if(--*slot < 0) {
+      *node = temp->prev;
+      *slot = (temp->prev ? temp->prev->count - 1 : 0);
+   }
+
+   return elem;
+}
+
+
+/** Indexed Linkedlist Functions */
+
+/**
+ * Pick the height of a new tower: zero (0) with probability 3/4, and each
+ * further level with probability 1/4.
+ *
+ * @return the number of levels of the tower.
+ **/
+static int __sk_height(llist_t* const list) {
+   unsigned int r;
+   int h;
+
+   /* xorshift32 */
+   r = list->__seed;
+   r ^= r << 13;
+   r ^= r >> 17;
+   r ^= r << 5;
+   list->__seed = r;
+
+   for(h = 0; !(r & 3) && h < SKIP_LEVELS; h++)
+      r >>= 2;
+
+   return h;
+}
+
+
+/**
+ * Allocate a tower.
+ *
+ * @param levels - the number of levels of the tower.
+ * @return the tower. Returns NULL upon allocation error.
+ **/
+static __tower_t* __sk_tower(__node_t* const node, int levels) {
+   __tower_t *tower;
+
+   tower = malloc(offsetof(__tower_t, lvl) + levels * sizeof(struct __level_s));
+
+   if(tower) tower->node = node;
+
+   return tower;
+}
+
+
+/**
+ * Build the skip list index of a list from its nodes, in a single pass.
+ *
+ * @return 1 if the index was built. Returns 0 upon allocation error, leaving
+ *    the list without an index.
+ **/
+static int __sk_build(llist_t* const list) {
+   __tower_t *last[SKIP_LEVELS], *tower;
+   __node_t *node;
+   int lastpos[SKIP_LEVELS];
+   int i, h, pos;
+
+   list->__skip = __sk_tower(NULL, SKIP_LEVELS);
+
+   if(!list->__skip) return 0;
+
+   for(i = 0; i < SKIP_LEVELS; i++) {
+      last[i] = list->__skip;
+      lastpos[i] = -1;
+   }
+
+   for(node = list->__first, pos = 0; node; node = node->next, pos++) {
+      h = __sk_height(list);
+
+      if(!h) continue;
+
+      tower = __sk_tower(node, h);
+
+      if(!tower) {
+         last[0]->lvl[0].next = NULL;
+         __sk_drop(list);
+
+         return 0;
+      }
+
+      /* Link each level of the tower after the last one reaching it */
+      for(i = 0; i < h; i++) {
+         last[i]->lvl[i].next = tower;
+         last[i]->lvl[i].width = pos - lastpos[i];
+         last[i] = tower;
+         lastpos[i] = pos;
+      }
+   }
+
+   /* Links off the end reach one past the last node */
+   for(i = 0; i < SKIP_LEVELS; i++) {
+      last[i]->lvl[i].next = NULL;
+      last[i]->lvl[i].width = list->__size - lastpos[i];
+   }
+
+   return 1;
+}
+
+
+/**
+ * Free the skip list index of a list, if it has one. Every tower has a
+ * first level, so walking that level reaches them all.
+ **/
+static void __sk_drop(llist_t* const list) {
+   __tower_t *tower, *next;
+
+   if(!list->__skip) return;
+
+   for(tower = list->__skip; tower; tower = next) {
+      next = tower->lvl[0].next;
+      free(tower);
+   }
+
+   list->__skip = NULL;
+}
+
+
+/**
+ * Find the node at a specified index through the skip list index.
+ *
+ * @param index - the index of the node; must be in [0, size).
+ * @return the node at the specified index.
+ **/
+static void* __sk_find(llist_t* const list, int index) {
+   __tower_t *x;
+   __node_t *temp;
+   int i, pos;
+
+   x = list->__skip;
+   pos = -1;
+
+   /* Descend, stopping at the last tower at or before index on each level */
+   for(i = SKIP_LEVELS - 1; i >= 0; i--)
+      while(x->lvl[i].next && pos + x->lvl[i].width <= index) {
+         pos += x->lvl[i].width;
+         x = x->lvl[i].next;
+      }
+
+   if(x->node) {
+      temp = x->node;
+   }
+   else {
+      temp = list->__first;
+      pos = 0;
+   }
+
+   for(; pos < index; pos++)
+      temp = temp->next;
+
+   return temp;
+}
+
+
+/**
+ * Find the last tower before a specified index on every level.
+ *
+ * @param update - set to the tower found on each level.
+ * @param upos - set to the index of each tower found; -1 for the head.
+ **/
+static void __sk_path(llist_t* const list, int index,
+                      __tower_t** const update, int* const upos) {
+   __tower_t *x;
+   int i, pos;
+
+   x = list->__skip;
+   pos = -1;
+
+   for(i = SKIP_LEVELS - 1; i >= 0; i--) {
+      while(x->lvl[i].next && pos + x->lvl[i].width < index) {
+         pos += x->lvl[i].width;
+         x = x->lvl[i].next;
+      }
+
+      update[i] = x;
+      upos[i] = pos;
+   }
+}
+
+
+/**
+ * Account for a node just linked in at a specified index, giving it a tower
+ * of random height. If the tower cannot be allocated the node goes without
+ * one, which leaves the index correct.
+ *
+ * @param node - the node added.
+ * @param index - the index of the node.
+ **/
+static void __sk_insert(llist_t* const list, void* const node, int index) {
+   __tower_t *update[SKIP_LEVELS], *tower;
+   int upos[SKIP_LEVELS];
+   int i, h;
+
+   if(!list->__skip) return;
+
+   __sk_path(list, index, update, upos);
+
+   h = __sk_height(list);
+   tower = (h ? __sk_tower(node, h) : NULL);
+
+   if(!tower) h = 0;
+
+   for(i = 0; i < SKIP_LEVELS; i++) {
+      /* Link the new tower in, splitting the span it falls in */
+      if(i < h) {
+         tower->lvl[i].next = update[i]->lvl[i].next;
+         tower->lvl[i].width = update[i]->lvl[i].width - (index - upos[i]) + 1;
+         update[i]->lvl[i].next = tower;
+         update[i]->lvl[i].width = index - upos[i];
+      }
+
+      /* The span now covers one more node */
+      else {
+         update[i]->lvl[i].width++;
+      }
+   }
+}
+
+
+/**
+ * Account for a node about to be unlinked from a specified index, freeing
+ * its tower.
+ *
+ * @param node - the node being removed.
+ * @param index - the index of the node.
+ **/
+static void __sk_remove(llist_t* const list, void* const node, int index) {
+   __tower_t *update[SKIP_LEVELS], *tower, *dead;
+   int upos[SKIP_LEVELS];
+   int i;
+
+   if(!list->__skip) return;
+
+   __sk_path(list, index, update, upos);
+   dead = NULL;
+
+   for(i = 0; i < SKIP_LEVELS; i++) {
+      tower = update[i]->lvl[i].next;
+
+      /* Unlink the node's tower, joining the spans either side */
+      if(tower && tower->node == node) {
+         update[i]->lvl[i].width += tower->lvl[i].width - 1;
+         update[i]->lvl[i].next = tower->lvl[i].next;
+         dead = tower;
+      }
+      else {
+         update[i]->lvl[i].width--;
+      }
+   }
+
+   free(dead);
+}
+
+
+/** Linkedlist Hash Index Functions */
+
+/**
+ * Makes a list keep, or stop keeping, a hash index of its elements, keyed by
+ * their bytes as ll_contains(...) compares them. The index maps each element
+ * to its node, so ll_contains(...), ll_remval(...), ll_tofront(...) and
+ * ll_toback(...) take O(1) expected time, and ll_indexof(...) need only
+ * count back from the node found. Order of the list is unaffected. Adding,
+ * removing and replacing elements keep the index current; the bulk
+ * operations drop it, and it is rebuilt on next use. Elements must not be
+ * changed in place while hashed. Unrolled lists cannot be hashed.
+ *
+ * @param list - the list to index.
+ * @param on - nonzero to keep an index, zero (0) to free it.
+ * @return 1 if the list is (or is no longer) hashed. Returns 0 if the list
+ *    is NULL or unrolled, or upon allocation error.
+ **/
+int ll_hashindex(llist_t* const list, int on) {
+   if(!list) return !ADDED;
+
+   if(!on) {
+      list->__flags &= ~LL_HASHED;
+      __ht_drop(list);
+
+      return ADDED;
+   }
+
+   if(list->__flags & LL_UNROLLED) return !ADDED;
+
+   if(!list->__htab && !__ht_build(list)) return !ADDED;
+
+   list->__flags |= LL_HASHED;
+   return ADDED;
+}
+
+
+/**
+ * Hash the bytes of an element: FNV-1a, with a final mix so that the low
+ * bits used to pick a slot depend on every byte.
+ *
+ * @param elem - the element to hash; may be NULL.
+ * @param width - the size of the element in bytes.
+ * @return the hash of the element.
+ **/
+static uint64_t __ht_hash(const void* elem, size_t width) {
+   const unsigned char *byte;
+   uint64_t hash;
+   size_t i;
+
+   if(!elem) return 0;
+
+   byte = elem;
+   hash = UINT64_C(14695981039346656037);
+
+   for(i = 0; i < width; i++) {
+      hash ^= byte[i];
+      hash *= UINT64_C(1099511628211);
+   }
+
+   hash ^= hash >> 33;
+   hash *= UINT64_C(0xff51afd7ed558ccd);
+   hash ^= hash >> 33;
+
+   return hash;
+}
+
+
+/**
+ * Make sure the hash index of a list is built, if the list is hashed.
+ *
+ * @return 1 if the list has a hash index, else 0.
+ **/
+static int __ht_ready(llist_t* const list) {
+   if(list->__htab) return 1;
+
+   if(!(list->__flags & LL_HASHED)) return 0;
+
+   return __ht_build(list);
+}
+
+
+/**
+ * Put a node in the first free slot from its hash. The table must have one.
+ **/
+static void __ht_put(llist_t* const list, __node_t* const node,
+                     uint64_t hash) {
+   __hslot_t *slot;
+   size_t i;
+
+   slot = list->__htab;
+
+   for(i = hash & list->__hmask; slot[i].node; i = (i + 1) & list->__hmask)
+      ;
+
+   slot[i].node = node;
+   slot[i].hash = hash;
+}
+
+
+/**
+ * Build the hash index of a list with at least twice as many slots as nodes.
+ *
+ * @return 1 if the index was built. Returns 0 upon allocation error.
+ **/
+static int __ht_build(llist_t* const list) {
+   __node_t *node;
+   size_t slots;
+
+   for(slots = HASH_MIN; slots < (size_t) list->__size * 2; slots <<= 1)
+      ;
+
+   list->__htab = calloc(slots, sizeof(__hslot_t));
+
+   if(!list->__htab) return 0;
+
+   list->__hmask = slots - 1;
+
+   for(node = list->__first; node; node = node->next)
+      __ht_put(list, node, __ht_hash(node->element, list->__elem_size));
+
+   return 1;
+}
+
+
+/**
+ * Free the hash index of a list, if it has one.
+ **/
+static void __ht_drop(llist_t* const list) {
+   free(list->__htab);
+   list->__htab = NULL;
+}
+
+
+/**
+ * Find the node of an element equal to a specified one through the hash
+ * index. Equal elements share a run of slots but not their order in the
+ * list.
+ *
+ * @param dups - set to nonzero if more than one element is equal.
+ * @return a node of an equal element. Returns NULL if there is none.
+ **/
+static void* __ht_find(llist_t* const list, void* const elem,
+                       int* const dups) {
+   __hslot_t *slot;
+   __node_t *found;
+   uint64_t hash;
+   size_t i;
+
+   slot = list->__htab;
+   hash = __ht_hash(elem, list->__elem_size);
+   found = NULL;
+   *dups = 0;
+
+   for(i = hash & list->__hmask; slot[i].node; i = (i + 1) & list->__hmask) {
+      if(slot[i].hash != hash || !slot[i].node->element)
+         continue;
+
+      if(memcmp(elem, slot[i].node->element, list->__elem_size) == 0) {
+         if(found) {
+            *dups = 1;
+            break;
+         }
+
+         found = slot[i].node;
+      }
+   }
+
+   return found;
+}
+
+
+/**
+ * Account for a node just linked into a list, doubling the table when it
+ * would pass three quarters full. If the table cannot grow it is dropped,
+ * to be rebuilt on next use.
+ *
+ * @param node - the node added.
+ **/
+static void __ht_insert(llist_t* const list, void* const node) {
+   __hslot_t *old;
+   size_t i, slots;
+
+   if(!list->__htab) return;
+
+   slots = list->__hmask + 1;
+
+   if(((size_t) list->__size + 1) * 4 > slots * 3) {
+      old = list->__htab;
+      list->__htab = calloc(slots * 2, sizeof(__hslot_t));
+
+      if(!list->__htab) {
+         free(old);
+         return;
+      }
+
+      list->__hmask = slots * 2 - 1;
+
+      for(i = 0; i < slots; i++)
+         if(old[i].node)
+            __ht_put(list, old[i].node, old[i].hash);
+
+      free(old);
+   }
+
+   __ht_put(list, node,
+            __ht_hash(((__node_t*) node)->element, list->__elem_size));
+}
+
+
+/**
+ * Account for a node about to be unlinked from a list, or about to have its
+ * element replaced. Later slots of the run are shifted back into the gap,
+ * so that no probe stops short of them.
+ *
+ * @param node - the node being removed.
+ **/
+static void __ht_remove(llist_t* const list, void* const node) {
+   __hslot_t *slot;
+   size_t i, j, mask;
+
+   if(!list->__htab) return;
+
+   slot = list->__htab;
+   mask = list->__hmask;
+
+   i = __ht_hash(((__node_t*) node)->element, list->__elem_size) & mask;
+
+   while(slot[i].node != node)
+      i = (i + 1) & mask;
+
+   /* A slot may fill the gap unless its own probe starts after the gap */
+   for(j = (i + 1) & mask; slot[j].node; j = (j + 1) & mask) {
+      if(((j - slot[j].hash) & mask) >= ((j - i) & mask)) {
+         slot[i] = slot[j];
+         i = j;
+      }
+   }
+
+   slot[i].node = NULL;
+}
+
+
+/** Linkedlist Node Pool Functions */
+
+/**
+ * A simulated constructor for a node pool. A pool hands out list nodes from
+ * large, cache-line-aligned chunks and recycles removed nodes, so adding to
+ * and removing from a list does not call malloc(...) or free(...) for each
+ * node. Every list has a private pool by default; a pool created here may be
+ * shared by several lists with ll_setpool(...). Pools are not thread-safe.
+ *
+ * @return a pointer to an empty pool. Returns a NULL pointer upon allocation
+ *    error.
+ **/
+ll_pool_t* ll_pool_init(void) {
+   ll_pool_t *pool;
+
+   pool = malloc(sizeof(ll_pool_t));
+
+   if(!pool) return NULL;
+
+   pool->__free = NULL;
+   pool->__flast = NULL;
+   pool->__bump = NULL;
+   pool->__end = NULL;
+   pool->__chunks = NULL;
+   pool->__clast = NULL;
+   pool->__node_size = 0;     /* Fixed by the first list to use it */
+   pool->__chunk_nodes = POOL_INIT_NODES;
+   pool->__refs = 1;
+
+   return pool;
+}
+
+
+/**
+ * A simulated destructor for a node pool. The pool itself is released once
+ * the last list using it is freed.
+ *
+ * @param pool - the pool to destroy.
+ **/
+void ll_pool_free(ll_pool_t* const pool) {
+   __ll_pool_drop(pool);
+}
+
+
+/**
+ * Makes an empty list take its nodes from the specified pool.
+ *
+ * @param list - the list to use the pool.
+ * @param pool - the pool to take nodes from.
+ * @return 1 if the list now uses the pool. Returns 0 if either pointer is
+ *    NULL, the list is not empty, or the pool already holds nodes of a
+ *    different size.
+ **/
+int ll_setpool(llist_t* const list, ll_pool_t* const pool) {
+   if(!list || !pool) return !ADDED;
+
+   if(list->__size) return !ADDED;
+
+   if(pool->__node_size && pool->__node_size != list->__node_size)
+      return !ADDED;
+
+   __ll_pool_drop(list->__pool);
+
+   pool->__node_size = list->__node_size;
+
+   pool->__refs++;
+   list->__pool = pool;
+
+   return ADDED;
+}
+
+
+/**
+ * Release a reference to a pool, freeing its chunks with the last one.
+ *
+ * @param pool - the pool to release; may be NULL.
+ **/
+static void __ll_pool_drop(ll_pool_t* const pool) {
+   if(!pool || --pool->__refs > 0) return;
+
+   __ll_unchunk(pool->__chunks);
+   free(pool);
+}
+
+
+/**
+ * Allocate a node for a list from its pool, creating a private pool for the
+ * list on first use.
+ *
+ * @param list - the list the node is for.
+ * @return an uninitialized node. Returns NULL upon allocation error.
+ **/
+static void* __ll_alloc(llist_t* const list) {
+   ll_pool_t *pool;
+   void *node, *chunk;
+
+   if(!list->__pool) {
+      list->__pool = ll_pool_init();
+
+      if(!list->__pool) return NULL;
+   }
+
+   pool = list->__pool;
+
+   /* Reuse a freed node */
+   if(pool->__free) {
+      node = pool->__free;
+      pool->__free = *(void**) node;
+
+      return node;
+   }
+
+   /* Newest chunk used up; chain on a larger one */
+   if(pool->__bump == pool->__end) {
+      if(!pool->__node_size)
+         pool->__node_size = list->__node_size;
+
+      chunk = __ll_chunk(pool, pool->__chunk_nodes);
+
+      if(!chunk) return NULL;
+
+      pool->__bump = chunk;
+      pool->__end = (char*) chunk + pool->__chunk_nodes * pool->__node_size;
+
+      if(pool->__chunk_nodes < POOL_MAX_NODES)
+         pool->__chunk_nodes <<= 1;
+   }
+
+   node = pool->__bump;
+   pool->__bump += pool->__node_size;
+
+   return node;
+}
+
+
+/**
+ * Allocate a chunk for a pool and chain it on. The chunk is aligned by hand
+ * to a cache line within a larger block from malloc(...). Its first cache
+ * line holds the chain and the block's address; its nodes follow.
+ *
+ * @param nodes - the number of nodes the chunk holds.
+ * @return the first node of the chunk. Returns NULL upon allocation error.
+ **/
+static void* __ll_chunk(ll_pool_t* const pool, int nodes) {
+   char *block;
+   void **chunk;
+
+   block = malloc(2 * CACHE_LINE - 1 + nodes * pool->__node_size);
+
+   if(!block) return NULL;
+
+   chunk = (void**) (block + (CACHE_LINE - 1 -
+                              ((size_t) block + CACHE_LINE - 1) % CACHE_LINE));
+
+   chunk[0] = pool->__chunks;
+   chunk[1] = block;
+
+   if(!pool->__chunks)
+      pool->__clast = chunk;
+
+   pool->__chunks = chunk;
+
+   return (char*) chunk + CACHE_LINE;
+}
+
+
+/**
+ * Free a chain of chunks.
+ *
+ * @param chunks - the first chunk of the chain; may be NULL.
+ **/
+static void __ll_unchunk(void* chunks) {
+   void **chunk;
+
+   while(chunks) {
+      chunk = chunks;
+      chunks = chunk[0];
+      free(chunk[1]);
+   }
+}
+
+
+/**
+ * Return a node of a list to its pool.
+ *
+ * @param list - the list the node belonged to.
+ * @param node - the node to return.
+ **/
+static void __ll_release(llist_t* const list, void* const node) {
+   if(!list->__pool->__free)
+      list->__pool->__flast = node;
+
+   *(void**) node = list->__pool->__free;
+   list->__pool->__free = node;
+
+   /* Counted only when it can trigger a compaction, and never past INT_MAX */
+   if(list->__autocompact && list->__churn < INT_MAX)
+      list->__churn++;
+}
+
+
+/** Linkedlist Iterator Functions */
+
+/**
+ * A simulated constructor for a linkedlist iterator. Returns an iterator over
+ * a specified linkedlist starting at a specified index.
+ *
+ * @param list - the list to return an iterator over.
+ * @param index - the position that the iterator will start at; may be the
+ *    size of the list.
+ * @return an iterator over the specified linkedlist. Returns a NULL pointer
+ *    if the specified list is NULL, (index < 0 || index > ll_size(list)), or
+ *    upon allocation error.
+ **/
+ll_itr_t* ll_itr(llist_t* const list, int index) {
+   ll_itr_t *iterator;
+
+   if(!list) return NULL;
+
+   if(index < 0 || index > list->__size)
+      return NULL;
+
+   iterator = malloc(sizeof(ll_itr_t));
+
+   if(!iterator) return NULL;
+
+   __ll_seek(list, index, &iterator->__cur);
+
+   iterator->__list = list;
+   iterator->__last = NULL;
+   iterator->__lslot = -1;
+   iterator->__lidx = -1;
+   iterator->__index = index;
+
+   return iterator;
+}
+
+
+/**
+ * A simulated destructor for a linkedlist iterator.
+ *
+ * @param iterator - the iterator to destroy.
+ **/
+void li_free(ll_itr_t* const itr) {
+   free(itr);
+}
+
+
+/**
+ * Indicates whether or not the iterator has more elements. In other words,
+ * returns 1 if li_next(...) would return an element.
+ *
+ * @param iterator - the iterator to check against for more elements.
+ * @return 1 if there exists more elements in the iterator. Returns 0 if the
+ *    iterator is NULL or does not have anymore elements.
+ **/
+int li_hasnext(ll_itr_t* const itr) {
+   if(!itr) return !EXIST;
+
+   /* There exists another element */
+   return (lc_hasnext(&itr->__cur) ? EXIST : !EXIST);
+}
+
+
+/**
+ * Indicates whether or not the iterator has previous elements. In other words,
+ * returns 1 if li_prev(...) would return an element.
+ *
+ * @param iterator - the iterator to check against for previous elements.
+ * @return 1 if there exists a previous element in the iterator. Returns 0 if
+ *    the iterator is NULL of does not have any previous elements.
+ **/
+int li_hasprev(ll_itr_t* const itr) {
+   if(!itr) return !EXIST;
+
+   /* There exists a previous element */
+   return (lc_hasprev(&itr->__cur) ? EXIST : !EXIST);
+}
+
+
+/**
+ * Retrieves (but does not remove) the next element in the iterator, moving
+ * the iterator past it.
  *
  * @param iterator - the iterator to return an element from.
  * @return the next element in the iterator. Returns NULL if the iterator is
  *    NULL or there are no more elements in the iterator.
  **/
 void* li_next(ll_itr_t* const itr) {
-   __node_t *temp;
-
-   if(!itr) return NULL;
+   if(!itr || !itr->__cur.__next) return NULL;
 
-   temp = itr->__next;
+   /* Remember the element for li_rem(...) and li_set(...) */
+   itr->__last = itr->__cur.__next;
+   itr->__lslot = itr->__cur.__nslot;
+   itr->__lidx = itr->__index++;
 
-   /* Move iterator ahead */
-   if(temp) {
-      itr->__next = temp->next;
-      return temp->element;
-   }
-
-   /* No more items */
-   return NULL;
+   return lc_next(&itr->__cur);
 }
 
 
 /**
- * Retrieves (but does not remove) the previous element in the iterator.
+ * Retrieves (but does not remove) the previous element in the iterator,
+ * moving the iterator before it.
  *
  * @param iterator - the iterator to return an element from.
  * @return the previous element in the iterator. Returns NULL if the iterator
  *    is NULL or there are no previous elements in the iterator.
  **/
 void* li_prev(ll_itr_t* const itr) {
+   if(!itr || !itr->__cur.__prev) return NULL;
+
+   itr->__last = itr->__cur.__prev;
+   itr->__lslot = itr->__cur.__pslot;
+   itr->__lidx = --itr->__index;
+
+   return lc_prev(&itr->__cur);
+}
+
+
+/**
+ * Inserts an element at the position of the iterator: before the element
+ * li_next(...) would return and after the one li_prev(...) would return. A
+ * following li_prev(...) returns the new element. Takes O(1) time, O(log n)
+ * for an indexed list.
+ *
+ * @param itr - the iterator to insert at.
+ * @param elem - the element to insert.
+ * @return 1 if the element is added. Returns 0 if the iterator is NULL or
+ *    upon allocation error.
+ **/
+int li_add(ll_itr_t* const itr, void* const elem) {
+   llist_t *list;
+   __node_t *new;
+
+   if(!itr) return !ADDED;
+
+   list = itr->__list;
+   itr->__last = NULL;
+
+   if((list->__flags & LL_INLINE) && !elem) return !ADDED;
+
+   /* Unrolled nodes shift their slots; insert there and find our place */
+   if(list->__flags & LL_UNROLLED) {
+      if(!__ul_add(list, itr->__index, elem)) return !ADDED;
+
+      __ll_seek(list, ++itr->__index, &itr->__cur);
+      return ADDED;
+   }
+
+   new = __ll_alloc(list);
+
+   if(!new) return !ADDED;
+
+   if(list->__flags & LL_INLINE)
+      new->element = memcpy(__INLINE(new), elem, list->__elem_size);
+   else
+      new->element = elem;
+
+   new->index = itr->__index;
+
+   __ll_join(list, itr->__cur.__prev, new);
+   __ll_join(list, new, itr->__cur.__next);
+   __sk_insert(list, new, itr->__index);
+   __ht_insert(list, new);
+
+   list->__finger = new;
+   list->__fidx = itr->__index;
+   list->__size++;
+
+   itr->__cur.__prev = new;
+   itr->__index++;
+
+   return ADDED;
+}
+
+
+/**
+ * Removes the element last returned by li_next(...) or li_prev(...). Takes
+ * O(1) time, O(log n) for an indexed list.
+ *
+ * @param itr - the iterator to remove with.
+ * @return the element removed. Returns NULL if the iterator is NULL, or if
+ *    neither li_next(...) nor li_prev(...) has been called since the last
+ *    li_add(...) or li_rem(...).
+ **/
+void* li_rem(ll_itr_t* const itr) {
+   llist_t *list;
+   __node_t *node;
+   void *result;
+
+   if(!itr || !itr->__last) return NULL;
+
+   list = itr->__list;
+   node = itr->__last;
+
+   itr->__last = NULL;
+   itr->__index = itr->__lidx;
+
+   if(list->__flags & LL_UNROLLED) {
+      result = __ul_rem(list, itr->__lidx);
+
+      __ll_seek(list, itr->__index, &itr->__cur);
+      return result;
+   }
+
+   __sk_remove(list, node, itr->__lidx);
+   __ht_remove(list, node);
+
+   /* Step the iterator off the node */
+   if(itr->__cur.__prev == node)
+      itr->__cur.__prev = node->prev;
+   else
+      itr->__cur.__next = node->next;
+
+   __ll_join(list, node->prev, node->next);
+
+   list->__finger = (node->next ? node->next : node->prev);
+   list->__fidx = (node->next ? itr->__lidx : itr->__lidx - 1);
+   list->__size--;
+
+   return __ll_out(list, node, NULL);
+}
+
+
+/**
+ * Replaces the element last returned by li_next(...) or li_prev(...).
+ *
+ * @param itr - the iterator to replace with.
+ * @param elem - the element to store in its place.
+ * @return the element replaced. Returns NULL if the iterator is NULL, or if
+ *    neither li_next(...) nor li_prev(...) has been called since the last
+ *    li_add(...) or li_rem(...).
+ **/
+void* li_set(ll_itr_t* const itr, void* const elem) {
+   if(!itr || !itr->__last) return NULL;
+
+   if((itr->__list->__flags & LL_INLINE) && !elem) return NULL;
+
+   if(itr->__lslot >= 0)
+      return __ul_replace(itr->__list, itr->__last, itr->__lslot, elem);
+
+   return __ll_replace(itr->__list, itr->__last, elem);
+}
+
+
+
+/** Linkedlist Cursor Functions */
+
+/**
+ * Position a caller-owned cursor over a specified linkedlist at a specified
+ * index. Unlike ll_itr(...), nothing is allocated.
+ *
+ * @param list - the list to walk.
+ * @param cur - the cursor to position.
+ * @param index - the position of the element the first lc_next(...) returns;
+ *    may be the size of the list.
+ * @return 1 if the cursor was positioned. Returns 0 if either pointer is NULL
+ *    or (index < 0 || index > ll_size(list)).
+ **/
+int ll_cur(llist_t* const list, ll_cur_t* const cur, int index) {
+   if(!list || !cur) return !EXIST;
+
+   if(index < 0 || index > list->__size)
+      return !EXIST;
+
+   __ll_seek(list, index, cur);
+
+   return EXIST;
+}
+
+
+/**
+ * Position a cursor before a specified index of a list.
+ *
+ * @param index - the index; must be in [0, size].
+ * @param cur - the cursor to position.
+ **/
+static void __ll_seek(llist_t* const list, int index, ll_cur_t* const cur) {
+   __node_t *temp;
+
+   if(list->__flags & LL_UNROLLED) {
+      cur->__prev = list->__last;
+      cur->__pslot = (list->__last ?
+                      ((__unode_t*) list->__last)->count - 1 : 0);
+      cur->__next = NULL;
+      cur->__nslot = 0;
+
+      if(index < list->__size) {
+         cur->__next = __ul_node(list, &index);
+         cur->__nslot = index;
+         cur->__prev = cur->__next;
+         cur->__pslot = index;
+
+         __ul_prev(&cur->__prev, &cur->__pslot);
+      }
+
+      return;
+   }
+
+   cur->__nslot = -1;
+   cur->__pslot = -1;
+
+   /* Positioned after the last element */
+   if(index == list->__size) {
+      cur->__next = NULL;
+      cur->__prev = list->__last;
+
+      return;
+   }
+
+   temp = __ll_node(list, index);
+
+   cur->__next = temp;
+   cur->__prev = temp->prev;
+}
+
+
+/**
+ * Retrieves the next element of a cursor and moves the cursor past it.
+ *
+ * @param cur - the cursor to return an element from.
+ * @return the next element of the cursor. Returns NULL if the cursor is NULL
+ *    or there are no more elements.
+ **/
+void* lc_next(ll_cur_t* const cur) {
    __node_t *temp;
 
-   if(!itr) return NULL;
+   if(!cur || !cur->__next) return NULL;
 
-   temp = itr->__prev;
+   if(cur->__nslot >= 0) {
+      cur->__prev = cur->__next;
+      cur->__pslot = cur->__nslot;
 
-   /* Move iterator backwards */
-   if(temp) {
-      itr->__prev = temp->prev;
-      return temp->element;
+      return __ul_next(&cur->__next, &cur->__nslot);
    }
 
-   /* No previous items */
-   return NULL;
+   temp = cur->__next;
+   cur->__prev = temp;
+   cur->__next = temp->next;
+
+   return temp->element;
 }
 
+
+/**
+ * Retrieves the previous element of a cursor and moves the cursor before it.
+ *
+ * @param cur - the cursor to return an element from.
+ * @return the previous element of the cursor. Returns NULL if the cursor is
+ *    NULL or there are no previous elements.
+ **/
+void* lc_prev(ll_cur_t* const cur) {
+   __node_t *temp;
+
+   if(!cur || !cur->__prev) return NULL;
+
+   if(cur->__pslot >= 0) {
+      cur->__next = cur->__prev;
+      cur->__nslot = cur->__pslot;
+
+      return __ul_prev(&cur->__prev, &cur->__pslot);
+   }
+
+   temp = cur->__prev;
+   cur->__next = temp;
+   cur->__prev = temp->prev;
+
+   return temp->element;
+}
@@ -16,19 +16,114 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see {http://www.gnu.org/licenses/}.
  **/
+#define _GNU_SOURCE     /* For posix_memalign(...), syscall(...) */
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>       /* For clock_gettime(...), nanosleep(...) */
 #include "dstructs.h"
 
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+#define RING_MIN 16     /* Fewest slots in a ring */
+#define CACHE_LINE 64   /* Alignment of concurrently written indices */
+#define SPIN_TRIES 128  /* Attempts made before a waiting thread sleeps */
+#define POLL_NS 100000  /* Sleep between attempts without futexes */
+
 
 /**
- * Internal definition of a queue. Built upon a linkedlist.
+ * Internal definition of a queue. Built upon a linkedlist, or upon a ring
+ * buffer when created with q_init_ring(...) or q_init_ring_inline(...).
  **/
 struct que_s {
-   llist_t *__list;
+   llist_t *__list;     /* NULL if the queue is a ring */
+   char *__ring;        /* Slots of a ring; the capacity is a power of two */
+   size_t __mask;       /* Slots in the ring, less one */
+   size_t __head;       /* Count of elements ever dequeued, masked to index */
+   size_t __tail;       /* Count of elements ever enqueued */
+   size_t __elem_size;
+   int __byval;         /* Nonzero if elements are held, not pointers */
+   void *__spare;       /* Copy of the element last dequeued, when inline */
+};
+
+
+/**
+ * Internal definition of a single-producer, single-consumer queue. The
+ * consumer's and producer's indices sit on cache lines of their own, each
+ * beside a cached copy of the other side's index, so that neither side reads
+ * the other's line until its copy says the ring is empty or full.
+ **/
+struct __q_spsc_s {
+   size_t __head;       /* Count of elements ever dequeued */
+   size_t __tail_seen;  /* Consumer's copy of the tail */
+   char __pad0[CACHE_LINE - 2 * sizeof(size_t)];
+   size_t __tail;       /* Count of elements ever enqueued */
+   size_t __head_seen;  /* Producer's copy of the head */
+   char __pad1[CACHE_LINE - 2 * sizeof(size_t)];
+   char *__ring;
+   size_t __mask;       /* Slots in the ring, less one */
+   size_t __elem_size;
 };
 
 
+/**
+ * Internal definition of a multi-producer, multi-consumer queue. Each cell of
+ * the ring starts with a sequence number saying whose turn it is: a producer
+ * may fill the cell for a count when the number equals that count, and a
+ * consumer may empty it when the number is one past. Producers and consumers
+ * each claim counts by advancing their own index, on a cache line of its
+ * own, with a compare-and-swap.
+ **/
+struct __q_mpmc_s {
+   size_t __tail;       /* Count of cells ever claimed by producers */
+   char __pad0[CACHE_LINE - sizeof(size_t)];
+   size_t __head;       /* Count of cells ever claimed by consumers */
+   char __pad1[CACHE_LINE - sizeof(size_t)];
+   int __deq_event;     /* Bumped to wake consumers waiting while empty */
+   int __deq_waiters;   /* Consumers about to sleep or asleep */
+   int __enq_event;     /* Bumped to wake producers waiting while full */
+   int __enq_waiters;   /* Producers about to sleep or asleep */
+   char __pad2[CACHE_LINE - 4 * sizeof(int)];
+   char *__cells;
+   size_t __mask;       /* Cells in the ring, less one */
+   size_t __elem_size;
+   size_t __cell_size;  /* Sequence number and element, rounded up */
+};
+
+
+/* Sequence number of the cell for a count, in a multi-producer ring */
+#define __CELL(Q, N) \
+   ((size_t*) ((Q)->__cells + ((N) & (Q)->__mask) * (Q)->__cell_size))
+
+
+/* Local functions */
+static que_t* __q_create(llist_t* const list, size_t elem_size,
+                         int is_inline);
+static que_t* __q_ring(size_t elem_size, int cap, int is_inline);
+static int    __q_grow(que_t* const q);
+static void*  __q_copy(void* const dst, const void* src, size_t size);
+static void   __q_spsc_put(q_spsc_t* const q, size_t pos, const char* src,
+                           size_t n);
+static void   __q_spsc_get(q_spsc_t* const q, size_t pos, char* dst,
+                           size_t n);
+static size_t __q_mpmc_claim(q_mpmc_t* const q, size_t* const index,
+                             size_t ahead, size_t want, size_t* const start);
+static void   __q_wake(int* const event, int* const waiters, int n);
+static int    __q_sleep(int* const event, int seen,
+                        const struct timespec* const deadline);
+
+
+/* Address of the slot at a count of elements in a ring */
+#define __SLOT(Q, N) ((Q)->__ring + ((N) & (Q)->__mask) * \
+                      ((Q)->__byval ? (Q)->__elem_size : sizeof(void*)))
+
+
 /**
  * A simulated constructor for a queue.
  *
@@ -41,19 +136,141 @@ struct que_s {
  *    error.
  **/
 que_t* __q_init(size_t __elem_size) {
+   return __q_create(__ll_init(__elem_size), __elem_size, 0);
+}
+
+
+/**
+ * A simulated constructor for an inline queue, which copies each element
+ * into its node on q_enq(...) rather than storing the pointer. Copy elements
+ * out with q_deq_into(...); q_deq(...) returns a copy held by the queue,
+ * valid until the next dequeue. See ll_init_inline(...).
+ *
+ * NOTE: This is a function that is not intended for use by the user. The user
+ * should instead use the macro q_init_inline(type).
+ *
+ * @param __elem_size - the size of an element in the queue.
+ * @return a pointer to an empty queue. Returns a NULL pointer upon allocation
+ *    error.
+ **/
+que_t* __q_init_inline(size_t __elem_size) {
+   return __q_create(__ll_init_inline(__elem_size), __elem_size, 1);
+}
+
+
+/**
+ * A simulated constructor for a ring queue, which keeps element pointers in
+ * one contiguous, circular array instead of list nodes. Enqueueing and
+ * dequeueing touch a single slot and allocate nothing, save when a full ring
+ * doubles its capacity. Every q_* function works on it as on any queue.
+ *
+ * NOTE: This is a function that is not intended for use by the user. The user
+ * should instead use the macro q_init_ring(type, cap).
+ *
+ * @param __elem_size - the size of an element in the queue.
+ * @param cap - the initial capacity, rounded up to a power of two; 0 (zero)
+ *    picks a small default.
+ * @return a pointer to an empty queue. Returns a NULL pointer if cap is
+ *    negative or upon allocation error.
+ **/
+que_t* __q_init_ring(size_t __elem_size, int cap) {
+   return __q_ring(__elem_size, cap, 0);
+}
+
+
+/**
+ * A simulated constructor for an inline ring queue, whose slots hold copies
+ * of the elements rather than pointers to them. As with q_init_inline(...),
+ * q_deq(...) returns a copy valid until the next dequeue, and
+ * q_deq_into(...) copies into a buffer.
+ *
+ * NOTE: This is a function that is not intended for use by the user. The user
+ * should instead use the macro q_init_ring_inline(type, cap).
+ *
+ * @param __elem_size - the size of an element in the queue.
+ * @param cap - the initial capacity, rounded up to a power of two; 0 (zero)
+ *    picks a small default.
+ * @return a pointer to an empty queue. Returns a NULL pointer if cap is
+ *    negative or upon allocation error.
+ **/
+que_t* __q_init_ring_inline(size_t __elem_size, int cap) {
+   return __q_ring(__elem_size, cap, 1);
+}
+
+
+/**
+ * Wrap a new list in a queue, freeing the list if the queue cannot be
+ * allocated.
+ *
+ * @param list - the list to wrap; may be NULL.
+ * @param elem_size - the size of an element in the list.
+ * @param is_inline - nonzero if the list is inline.
+ * @return a pointer to an empty queue. Returns a NULL pointer if the list is
+ *    NULL or upon allocation error.
+ **/
+static que_t* __q_create(llist_t* const list, size_t elem_size,
+                         int is_inline) {
    que_t *queue;
 
+   if(!list) return NULL;
+
    queue = malloc(sizeof(que_t));
 
+   if(!queue) {
+      ll_free(list);
+      return NULL;
+   }
+
+   queue->__list = list;
+   queue->__ring = NULL;
+   queue->__mask = 0;
+   queue->__head = 0;
+   queue->__tail = 0;
+   queue->__elem_size = elem_size;
+   queue->__byval = is_inline;
+   queue->__spare = NULL;
+
+   return queue;
+}
+
+
+/**
+ * Allocate and initialize an empty ring queue.
+ *
+ * @param is_inline - nonzero for slots holding elements, zero (0) for slots
+ *    holding pointers.
+ * @return a pointer to an empty queue. Returns a NULL pointer if cap is
+ *    negative or upon allocation error.
+ **/
+static que_t* __q_ring(size_t elem_size, int cap, int is_inline) {
+   que_t *queue;
+   size_t slots;
+
+   if(cap < 0) return NULL;
+
+   for(slots = RING_MIN; slots < (size_t) cap; slots <<= 1)
+      ;
+
+   /* An inline queue keeps its spare element just past itself */
+   queue = malloc(sizeof(que_t) + (is_inline ? elem_size : 0));
+
    if(!queue) return NULL;
 
-   queue->__list = __ll_init(__elem_size);
+   queue->__ring = malloc(slots * (is_inline ? elem_size : sizeof(void*)));
 
-   if(!queue->__list) {
+   if(!queue->__ring) {
       free(queue);
       return NULL;
    }
 
+   queue->__list = NULL;
+   queue->__mask = slots - 1;
+   queue->__head = 0;
+   queue->__tail = 0;
+   queue->__elem_size = elem_size;
+   queue->__byval = is_inline;
+   queue->__spare = (is_inline ? (void*) (queue + 1) : NULL);
+
    return queue;
 }
 
@@ -66,6 +283,15 @@ que_t* __q_init(size_t __elem_size) {
 void q_free(que_t* const q) {
    if(!q) return;
 
+   /* As with a list, elements still pointed to are freed */
+   if(!q->__list) {
+      if(!q->__byval)
+         for(; q->__head != q->__tail; q->__head++)
+            free(*(void**) __SLOT(q, q->__head));
+
+      free(q->__ring);
+   }
+
    ll_free(q->__list);
    free(q);
 
@@ -81,7 +307,11 @@ void q_free(que_t* const q) {
  *    NULL.
  **/
 int q_size(que_t* const q) {
-   return (q ? ll_size(q->__list) : -1);
+   if(!q) return -1;
+
+   if(!q->__list) return (int) (q->__tail - q->__head);
+
+   return ll_size(q->__list);
 }
 
 
@@ -95,7 +325,16 @@ int q_size(que_t* const q) {
  *    NULL if the queue is NULL.
  **/
 void* q_head(que_t* const q) {
-   return (q ? ll_first(q->__list) : NULL);
+   if(!q) return NULL;
+
+   if(!q->__list) {
+      if(q->__head == q->__tail) return NULL;
+
+      return (q->__byval ? (void*) __SLOT(q, q->__head) :
+                            *(void**) __SLOT(q, q->__head));
+   }
+
+   return ll_first(q->__list);
 }
 
 
@@ -109,7 +348,16 @@ void* q_head(que_t* const q) {
  *    NULL if the queue is NULL.
  **/
 void* q_tail(que_t* const q) {
-   return (q ? ll_last(q->__list) : NULL);
+   if(!q) return NULL;
+
+   if(!q->__list) {
+      if(q->__head == q->__tail) return NULL;
+
+      return (q->__byval ? (void*) __SLOT(q, q->__tail - 1) :
+                            *(void**) __SLOT(q, q->__tail - 1));
+   }
+
+   return ll_last(q->__list);
 }
 
 
@@ -123,6 +371,19 @@ void* q_tail(que_t* const q) {
 void q_enq(que_t* const q, void* const elem) {
    if(!q || !elem) return;
 
+   if(!q->__list) {
+      if(q->__tail - q->__head > q->__mask && !__q_grow(q))
+         return;
+
+      if(q->__byval)
+         __q_copy(__SLOT(q, q->__tail), elem, q->__elem_size);
+      else
+         *(void**) __SLOT(q, q->__tail) = elem;
+
+      q->__tail++;
+      return;
+   }
+
    ll_addl(q->__list, elem);
 }
 
@@ -134,7 +395,49 @@ void q_enq(que_t* const q, void* const elem) {
  * @return the head of the queue. Returns NULL if the queue is empty or NULL.
  **/
 void* q_deq(que_t* const q) {
-   return (q ? ll_remf(q->__list) : NULL);
+   void *slot;
+
+   if(!q) return NULL;
+
+   if(!q->__list) {
+      if(q->__head == q->__tail) return NULL;
+
+      slot = __SLOT(q, q->__head++);
+
+      if(q->__byval)
+         return __q_copy(q->__spare, slot, q->__elem_size);
+
+      return *(void**) slot;
+   }
+
+   return ll_remf(q->__list);
+}
+
+
+/**
+ * Removes the head of the queue, copying it into a buffer. See
+ * ll_rem_into(...).
+ *
+ * @param q - the queue to retrieve the element from.
+ * @param out - a buffer of at least the queue's element size.
+ * @return 1 if an element was removed. Returns 0 if either pointer is NULL or
+ *    the queue is empty.
+ **/
+int q_deq_into(que_t* const q, void* const out) {
+   void *slot;
+
+   if(!q) return 0;
+
+   if(!q->__list) {
+      if(!out || q->__head == q->__tail) return 0;
+
+      slot = __SLOT(q, q->__head++);
+
+      __q_copy(out, (q->__byval ? slot : *(void**) slot), q->__elem_size);
+      return 1;
+   }
+
+   return ll_remf_into(q->__list, out);
 }
 
 
@@ -147,6 +450,847 @@ void* q_deq(que_t* const q) {
  *    the queue is NULL.
  **/
 void** q_toarr(que_t* const q) {
-   return (q ? ll_toarr(q->__list) : NULL);
+   void **array;
+   size_t i;
+
+   if(!q) return NULL;
+
+   if(!q->__list) {
+      array = malloc(sizeof(void*) * (q->__tail - q->__head));
+
+      if(!array) return NULL;
+
+      for(i = 0; q->__head + i != q->__tail; i++)
+         array[i] = (q->__byval ? (void*) __SLOT(q, q->__head + i) :
+                                   *(void**) __SLOT(q, q->__head + i));
+
+      return array;
+   }
+
+   return ll_toarr(q->__list);
+}
+
+
+/**
+ * Adds the elements of an array to the end of the queue, in order, as though
+ * by q_enq(...) on each, but with the checks made once. A ring queue grows
+ * to fit all of them up front and copies the array in one or two blocks.
+ * The array holds what the queue holds: elements for an inline queue, and
+ * pointers to elements otherwise.
+ *
+ * @param q - the queue to add the elements to.
+ * @param elems - an array of n elements, or of n pointers to elements.
+ * @param n - the number of elements to add.
+ * @return the number of elements added, from the front of the array; fewer
+ *    than n only upon allocation error or, for pointers, at a NULL one.
+ *    Returns 0 if either pointer is NULL or n is not positive.
+ **/
+int q_enq_n(que_t* const q, const void* const elems, int n) {
+   const char *src;
+   size_t slot, at, first;
+   int i;
+
+   if(!q || !elems || n <= 0) return 0;
+
+   src = elems;
+   slot = (q->__byval ? q->__elem_size : sizeof(void*));
+
+   if(q->__list) {
+      for(i = 0; i < n; i++) {
+         if(!q->__byval && !((void* const*) elems)[i]) break;
+
+         if(!ll_add(q->__list, ll_size(q->__list),
+                    (q->__byval ? (void*) (src + i * slot) :
+                                  ((void* const*) elems)[i])))
+            break;
+      }
+
+      return i;
+   }
+
+   if(!q->__byval)
+      for(i = 0; i < n; i++)
+         if(!((void* const*) elems)[i]) n = i;
+
+   while(q->__tail - q->__head + n > q->__mask + 1)
+      if(!__q_grow(q))
+         n = (int) (q->__mask + 1 - (q->__tail - q->__head));
+
+   at = q->__tail & q->__mask;
+   first = q->__mask + 1 - at;
+
+   if(first > (size_t) n) first = n;
+
+   memcpy(q->__ring + at * slot, src, first * slot);
+   memcpy(q->__ring, src + first * slot, (n - first) * slot);
+
+   q->__tail += n;
+   return n;
+}
+
+
+/**
+ * Removes up to n elements from the head of the queue into an array, in
+ * order, as though by q_deq(...) on each. The array is filled with what the
+ * queue holds: elements for an inline queue, which are copied out as by
+ * q_deq_into(...), and pointers to elements otherwise.
+ *
+ * @param q - the queue to remove the elements from.
+ * @param out - an array with room for n elements, or for n pointers.
+ * @param n - the most elements to remove.
+ * @return the number of elements removed. Returns 0 if either pointer is
+ *    NULL, n is not positive, or the queue is empty.
+ **/
+int q_deq_n(que_t* const q, void* const out, int n) {
+   char *dst;
+   size_t slot, at, first;
+   int i;
+
+   if(!q || !out || n <= 0) return 0;
+
+   dst = out;
+   slot = (q->__byval ? q->__elem_size : sizeof(void*));
+
+   if(q->__list) {
+      for(i = 0; i < n && ll_size(q->__list); i++) {
+         if(q->__byval)
+            ll_remf_into(q->__list, dst + i * slot);
+         else
+            ((void**) out)[i] = ll_remf(q->__list);
+      }
+
+      return i;
+   }
+
+   if((size_t) n > q->__tail - q->__head)
+      n = (int) (q->__tail - q->__head);
+
+   at = q->__head & q->__mask;
+   first = q->__mask + 1 - at;
+
+   if(first > (size_t) n) first = n;
+
+   memcpy(dst, q->__ring + at * slot, first * slot);
+   memcpy(dst + first * slot, q->__ring, (n - first) * slot);
+
+   q->__head += n;
+   return n;
+}
+
+
+/**
+ * Double the capacity of a ring. The slots before the head, where elements
+ * may have wrapped around to, move to just past the old end so that the
+ * elements stay in order.
+ *
+ * @return 1 if the ring grew. Returns 0 upon allocation error.
+ **/
+static int __q_grow(que_t* const q) {
+   char *ring;
+   size_t slot, slots, head, count;
+
+   slot = (q->__byval ? q->__elem_size : sizeof(void*));
+   slots = q->__mask + 1;
+   head = q->__head & q->__mask;
+   count = q->__tail - q->__head;
+
+   ring = realloc(q->__ring, 2 * slots * slot);
+
+   if(!ring) return 0;
+
+   memcpy(ring + slots * slot, ring, head * slot);
+
+   q->__ring = ring;
+   q->__mask = 2 * slots - 1;
+   q->__head = head;
+   q->__tail = head + count;
+
+   return 1;
+}
+
+
+/**
+ * Copy an element. Copies of the common sizes are fixed-size, which the
+ * compiler turns into plain loads and stores instead of a call.
+ *
+ * @return the destination.
+ **/
+static void* __q_copy(void* const dst, const void* src, size_t size) {
+   switch(size) {
+      case 4:  return memcpy(dst, src, 4);
+      case 8:  return memcpy(dst, src, 8);
+      case 16: return memcpy(dst, src, 16);
+      default: return memcpy(dst, src, size);
+   }
+}
+
+
+/** Single-Producer, Single-Consumer Queue Functions */
+
+/**
+ * A simulated constructor for a single-producer, single-consumer queue: a
+ * bounded ring of element copies that one thread may enqueue to while one
+ * other thread dequeues from, with no locks. Each side publishes its index
+ * with a release store and reads the other's with an acquire load, only
+ * when its cached copy of that index runs out. Nothing else in this library
+ * is thread-safe, and no more than one producer and one consumer may use the
+ * queue at once.
+ *
+ * NOTE: This is a function that is not intended for use by the user. The user
+ * should instead use the macro q_spsc_init(type, cap).
+ *
+ * @param __elem_size - the size of an element in the queue.
+ * @param cap - the capacity, rounded up to a power of two; 0 (zero) picks a
+ *    small default.
+ * @return a pointer to an empty queue. Returns a NULL pointer if cap is
+ *    negative or upon allocation error.
+ **/
+q_spsc_t* __q_spsc_init(size_t __elem_size, int cap) {
+   q_spsc_t *q;
+   void *mem;
+   size_t slots;
+
+   if(cap < 0) return NULL;
+
+   for(slots = RING_MIN; slots < (size_t) cap; slots <<= 1)
+      ;
+
+   if(posix_memalign(&mem, CACHE_LINE, sizeof(q_spsc_t)) != 0)
+      return NULL;
+
+   q = mem;
+
+   if(posix_memalign(&mem, CACHE_LINE, slots * __elem_size) != 0) {
+      free(q);
+      return NULL;
+   }
+
+   q->__ring = mem;
+   q->__mask = slots - 1;
+   q->__elem_size = __elem_size;
+   q->__head = 0;
+   q->__tail_seen = 0;
+   q->__tail = 0;
+   q->__head_seen = 0;
+
+   return q;
+}
+
+
+/**
+ * A simulated destructor for a single-producer, single-consumer queue. Only
+ * call once neither side uses the queue.
+ *
+ * @param q - the queue to destroy.
+ **/
+void q_spsc_free(q_spsc_t* const q) {
+   if(!q) return;
+
+   free(q->__ring);
+   free(q);
+}
+
+
+/**
+ * Retrieve the number of elements in a single-producer, single-consumer
+ * queue. While either side is active this is only a snapshot.
+ *
+ * @param q - the queue to retrieve the size of.
+ * @return the number of elements in the queue. Returns -1 if the queue is
+ *    NULL.
+ **/
+int q_spsc_size(q_spsc_t* const q) {
+   size_t head;
+
+   if(!q) return -1;
+
+   head = __atomic_load_n(&q->__head, __ATOMIC_ACQUIRE);
+
+   return (int) (__atomic_load_n(&q->__tail, __ATOMIC_ACQUIRE) - head);
+}
+
+
+/**
+ * Copies an element onto the end of a single-producer, single-consumer queue.
+ * Only the producer thread may call this.
+ *
+ * @param q - the queue to add the element to.
+ * @param elem - the element to copy in.
+ * @return 1 if the element was added. Returns 0 if either pointer is NULL or
+ *    the queue is full.
+ **/
+int q_spsc_enq(q_spsc_t* const q, const void* const elem) {
+   size_t tail;
+
+   if(!q || !elem) return 0;
+
+   tail = __atomic_load_n(&q->__tail, __ATOMIC_RELAXED);
+
+   /* Looks full; see how far the consumer has got */
+   if(tail - q->__head_seen > q->__mask) {
+      q->__head_seen = __atomic_load_n(&q->__head, __ATOMIC_ACQUIRE);
+
+      if(tail - q->__head_seen > q->__mask) return 0;
+   }
+
+   __q_copy(q->__ring + (tail & q->__mask) * q->__elem_size, elem,
+            q->__elem_size);
+
+   __atomic_store_n(&q->__tail, tail + 1, __ATOMIC_RELEASE);
+   return 1;
+}
+
+
+/**
+ * Copies the head of a single-producer, single-consumer queue into a buffer
+ * and removes it. Only the consumer thread may call this.
+ *
+ * @param q - the queue to remove the element from.
+ * @param out - a buffer of at least the queue's element size.
+ * @return 1 if an element was removed. Returns 0 if either pointer is NULL or
+ *    the queue is empty.
+ **/
+int q_spsc_deq(q_spsc_t* const q, void* const out) {
+   size_t head;
+
+   if(!q || !out) return 0;
+
+   head = __atomic_load_n(&q->__head, __ATOMIC_RELAXED);
+
+   /* Looks empty; see how far the producer has got */
+   if(head == q->__tail_seen) {
+      q->__tail_seen = __atomic_load_n(&q->__tail, __ATOMIC_ACQUIRE);
+
+      if(head == q->__tail_seen) return 0;
+   }
+
+   __q_copy(out, q->__ring + (head & q->__mask) * q->__elem_size,
+            q->__elem_size);
+
+   __atomic_store_n(&q->__head, head + 1, __ATOMIC_RELEASE);
+   return 1;
+}
+
+
+/**
+ * Copies as many elements of an array as fit onto the end of a
+ * single-producer, single-consumer queue, publishing them all with a single
+ * store. Only the producer thread may call this.
+ *
+ * @param q - the queue to add the elements to.
+ * @param elems - an array of n elements.
+ * @param n - the number of elements to add.
+ * @return the number of elements added, from the front of the array. Returns
+ *    0 if either pointer is NULL or n is not positive.
+ **/
+int q_spsc_enq_n(q_spsc_t* const q, const void* const elems, int n) {
+   size_t tail, room;
+
+   if(!q || !elems || n <= 0) return 0;
+
+   tail = __atomic_load_n(&q->__tail, __ATOMIC_RELAXED);
+   room = q->__mask + 1 - (tail - q->__head_seen);
+
+   if(room < (size_t) n) {
+      q->__head_seen = __atomic_load_n(&q->__head, __ATOMIC_ACQUIRE);
+      room = q->__mask + 1 - (tail - q->__head_seen);
+   }
+
+   if(room < (size_t) n) n = (int) room;
+
+   __q_spsc_put(q, tail, elems, n);
+
+   __atomic_store_n(&q->__tail, tail + n, __ATOMIC_RELEASE);
+   return n;
+}
+
+
+/**
+ * Copies up to n elements from the head of a single-producer,
+ * single-consumer queue into an array and removes them, with a single store.
+ * Only the consumer thread may call this.
+ *
+ * @param q - the queue to remove the elements from.
+ * @param out - an array with room for n elements.
+ * @param n - the most elements to remove.
+ * @return the number of elements removed. Returns 0 if either pointer is
+ *    NULL or n is not positive.
+ **/
+int q_spsc_deq_n(q_spsc_t* const q, void* const out, int n) {
+   size_t head, avail;
+
+   if(!q || !out || n <= 0) return 0;
+
+   head = __atomic_load_n(&q->__head, __ATOMIC_RELAXED);
+   avail = q->__tail_seen - head;
+
+   if(avail < (size_t) n) {
+      q->__tail_seen = __atomic_load_n(&q->__tail, __ATOMIC_ACQUIRE);
+      avail = q->__tail_seen - head;
+   }
+
+   if(avail < (size_t) n) n = (int) avail;
+
+   __q_spsc_get(q, head, out, n);
+
+   __atomic_store_n(&q->__head, head + n, __ATOMIC_RELEASE);
+   return n;
+}
+
+
+/**
+ * Copy elements into consecutive slots of a ring, from a count onward,
+ * wrapping around at its end.
+ **/
+static void __q_spsc_put(q_spsc_t* const q, size_t pos, const char* src,
+                         size_t n) {
+   size_t at, first;
+
+   at = pos & q->__mask;
+   first = q->__mask + 1 - at;
+
+   if(first > n) first = n;
+
+   memcpy(q->__ring + at * q->__elem_size, src, first * q->__elem_size);
+   memcpy(q->__ring, src + first * q->__elem_size,
+          (n - first) * q->__elem_size);
+}
+
+
+/**
+ * Copy elements out of consecutive slots of a ring, from a count onward,
+ * wrapping around at its end.
+ **/
+static void __q_spsc_get(q_spsc_t* const q, size_t pos, char* dst,
+                         size_t n) {
+   size_t at, first;
+
+   at = pos & q->__mask;
+   first = q->__mask + 1 - at;
+
+   if(first > n) first = n;
+
+   memcpy(dst, q->__ring + at * q->__elem_size, first * q->__elem_size);
+   memcpy(dst + first * q->__elem_size, q->__ring,
+          (n - first) * q->__elem_size);
+}
+
+
+/** Multi-Producer, Multi-Consumer Queue Functions */
+
+/**
+ * A simulated constructor for a multi-producer, multi-consumer queue: a
+ * bounded ring of element copies that any number of threads may enqueue to
+ * and dequeue from at once, with no locks. Threads contend only on the
+ * producers' or the consumers' index, never on a shared lock, and a thread
+ * that is descheduled mid-copy holds up only the cell it is copying.
+ *
+ * NOTE: This is a function that is not intended for use by the user. The user
+ * should instead use the macro q_mpmc_init(type, cap).
+ *
+ * @param __elem_size - the size of an element in the queue.
+ * @param cap - the capacity, rounded up to a power of two; 0 (zero) picks a
+ *    small default.
+ * @return a pointer to an empty queue. Returns a NULL pointer if cap is
+ *    negative or upon allocation error.
+ **/
+q_mpmc_t* __q_mpmc_init(size_t __elem_size, int cap) {
+   q_mpmc_t *q;
+   void *mem;
+   size_t slots, i;
+
+   if(cap < 0) return NULL;
+
+   for(slots = RING_MIN; slots < (size_t) cap; slots <<= 1)
+      ;
+
+   if(posix_memalign(&mem, CACHE_LINE, sizeof(q_mpmc_t)) != 0)
+      return NULL;
+
+   q = mem;
+   q->__cell_size = (sizeof(size_t) + __elem_size + sizeof(size_t) - 1) &
+                    ~(sizeof(size_t) - 1);
+
+   if(posix_memalign(&mem, CACHE_LINE, slots * q->__cell_size) != 0) {
+      free(q);
+      return NULL;
+   }
+
+   q->__cells = mem;
+   q->__mask = slots - 1;
+   q->__elem_size = __elem_size;
+   q->__tail = 0;
+   q->__head = 0;
+   q->__deq_event = 0;
+   q->__deq_waiters = 0;
+   q->__enq_event = 0;
+   q->__enq_waiters = 0;
+
+   /* Every cell awaits the producer of its first count */
+   for(i = 0; i < slots; i++)
+      *__CELL(q, i) = i;
+
+   return q;
+}
+
+
+/**
+ * A simulated destructor for a multi-producer, multi-consumer queue. Only
+ * call once no thread uses the queue.
+ *
+ * @param q - the queue to destroy.
+ **/
+void q_mpmc_free(q_mpmc_t* const q) {
+   if(!q) return;
+
+   free(q->__cells);
+   free(q);
+}
+
+
+/**
+ * Retrieve the number of elements in a multi-producer, multi-consumer queue.
+ * While other threads are active this is only a snapshot, and counts
+ * elements still being copied in or out.
+ *
+ * @param q - the queue to retrieve the size of.
+ * @return the number of elements in the queue. Returns -1 if the queue is
+ *    NULL.
+ **/
+int q_mpmc_size(q_mpmc_t* const q) {
+   size_t head, tail;
+
+   if(!q) return -1;
+
+   head = __atomic_load_n(&q->__head, __ATOMIC_ACQUIRE);
+   tail = __atomic_load_n(&q->__tail, __ATOMIC_ACQUIRE);
+
+   return (tail - head > q->__mask + 1 ? 0 : (int) (tail - head));
+}
+
+
+/**
+ * Tries to copy an element onto the end of a multi-producer, multi-consumer
+ * queue. Any thread may call this.
+ *
+ * @param q - the queue to add the element to.
+ * @param elem - the element to copy in.
+ * @return 1 if the element was added. Returns 0 if either pointer is NULL or
+ *    the queue is full.
+ **/
+int q_mpmc_try_enq(q_mpmc_t* const q, const void* const elem) {
+   return q_mpmc_try_enq_n(q, elem, 1);
+}
+
+
+/**
+ * Tries to copy the head of a multi-producer, multi-consumer queue into a
+ * buffer and remove it. Any thread may call this.
+ *
+ * @param q - the queue to remove the element from.
+ * @param out - a buffer of at least the queue's element size.
+ * @return 1 if an element was removed. Returns 0 if either pointer is NULL or
+ *    the queue is empty.
+ **/
+int q_mpmc_try_deq(q_mpmc_t* const q, void* const out) {
+   return q_mpmc_try_deq_n(q, out, 1);
+}
+
+
+/**
+ * Copies as many elements of an array as there are free cells for onto the
+ * end of a multi-producer, multi-consumer queue. The cells are claimed with
+ * a single compare-and-swap, so the elements stay together in the queue.
+ *
+ * @param q - the queue to add the elements to.
+ * @param elems - an array of n elements.
+ * @param n - the number of elements to add.
+ * @return the number of elements added, from the front of the array. Returns
+ *    0 if either pointer is NULL, n is not positive, or the queue is full.
+ **/
+int q_mpmc_try_enq_n(q_mpmc_t* const q, const void* const elems, int n) {
+   const char *src;
+   size_t pos, got, i;
+
+   if(!q || !elems || n <= 0) return 0;
+
+   got = __q_mpmc_claim(q, &q->__tail, 0, n, &pos);
+   src = elems;
+
+   for(i = 0; i < got; i++) {
+      __q_copy(__CELL(q, pos + i) + 1, src + i * q->__elem_size,
+               q->__elem_size);
+
+      /* Hand the cell to the consumer of this count */
+      __atomic_store_n(__CELL(q, pos + i), pos + i + 1, __ATOMIC_RELEASE);
+   }
+
+   if(got) __q_wake(&q->__deq_event, &q->__deq_waiters, (int) got);
+
+   return (int) got;
+}
+
+
+/**
+ * Copies up to n elements from the head of a multi-producer, multi-consumer
+ * queue into an array and removes them. The cells are claimed with a single
+ * compare-and-swap, so the elements are consecutive in the queue.
+ *
+ * @param q - the queue to remove the elements from.
+ * @param out - an array with room for n elements.
+ * @param n - the most elements to remove.
+ * @return the number of elements removed. Returns 0 if either pointer is
+ *    NULL, n is not positive, or the queue is empty.
+ **/
+int q_mpmc_try_deq_n(q_mpmc_t* const q, void* const out, int n) {
+   char *dst;
+   size_t pos, got, i;
+
+   if(!q || !out || n <= 0) return 0;
+
+   got = __q_mpmc_claim(q, &q->__head, 1, n, &pos);
+   dst = out;
+
+   for(i = 0; i < got; i++) {
+      __q_copy(dst + i * q->__elem_size, __CELL(q, pos + i) + 1,
+               q->__elem_size);
+
+      /* Hand the cell to the producer of its next count */
+      __atomic_store_n(__CELL(q, pos + i), pos + i + q->__mask + 1,
+                       __ATOMIC_RELEASE);
+   }
+
+   if(got) __q_wake(&q->__enq_event, &q->__enq_waiters, (int) got);
+
+   return (int) got;
+}
+
+
+/**
+ * Claim up to a number of consecutive counts from the producers' or the
+ * consumers' index. Cells are counted from the index while their sequence
+ * numbers say they are ready for this side; the index is then advanced past
+ * them in one compare-and-swap, retried from the new index if another thread
+ * moved it first. No other thread can touch a ready cell until its count is
+ * claimed, so the cells stay ready until the swap.
+ *
+ * @param index - the producers' or the consumers' index.
+ * @param ahead - how far the sequence number of a ready cell is ahead of its
+ *    count: 0 (zero) for producers, 1 for consumers.
+ * @param want - the most counts to claim.
+ * @param start - set to the first count claimed.
+ * @return the number of counts claimed. Returns 0 if the cell at the index is
+ *    not ready, meaning the queue is full or empty.
+ **/
+static size_t __q_mpmc_claim(q_mpmc_t* const q, size_t* const index,
+                             size_t ahead, size_t want, size_t* const start) {
+   size_t pos, got;
+   long dif;
+
+   pos = __atomic_load_n(index, __ATOMIC_RELAXED);
+
+   for(;;) {
+      dif = 0;
+
+      for(got = 0; got < want; got++) {
+         dif = (long) (__atomic_load_n(__CELL(q, pos + got), __ATOMIC_ACQUIRE) -
+                       (pos + got + ahead));
+
+         if(dif) break;
+      }
+
+      if(got) {
+         if(__atomic_compare_exchange_n(index, &pos, pos + got, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            *start = pos;
+            return got;
+         }
+      }
+
+      /* The cell is a lap behind: full, or empty */
+      else if(dif < 0) {
+         return 0;
+      }
+
+      /* Another thread claimed the count; start again from the index */
+      else {
+         pos = __atomic_load_n(index, __ATOMIC_RELAXED);
+      }
+   }
+}
+
+
+/**
+ * Copies an element onto the end of a multi-producer, multi-consumer queue,
+ * waiting for room if it is full. A waiting thread retries briefly, then
+ * sleeps until a consumer frees a cell; on Linux it sleeps on a futex and so
+ * costs no CPU, elsewhere it polls.
+ *
+ * @param q - the queue to add the element to.
+ * @param elem - the element to copy in.
+ * @param timeout_ns - the longest to wait, in nanoseconds; negative to wait
+ *    for as long as it takes, 0 (zero) not to sleep.
+ * @return 1 if the element was added. Returns 0 if either pointer is NULL or
+ *    the queue stayed full until the timeout.
+ **/
+int q_mpmc_enq_wait(q_mpmc_t* const q, const void* const elem,
+                    long timeout_ns) {
+   struct timespec deadline;
+   int i, ok, seen;
+
+   if(!q || !elem) return 0;
+
+   for(i = 0; i < SPIN_TRIES; i++)
+      if(q_mpmc_try_enq(q, elem)) return 1;
+
+   if(!timeout_ns) return 0;
+
+   if(timeout_ns > 0) {
+      clock_gettime(CLOCK_MONOTONIC, &deadline);
+      deadline.tv_sec += timeout_ns / 1000000000L;
+      deadline.tv_nsec += timeout_ns % 1000000000L;
+   }
+
+   /* Announce the wait before the last attempt, so no wake is missed */
+   do {
+      __atomic_add_fetch(&q->__enq_waiters, 1, __ATOMIC_SEQ_CST);
+      seen = __atomic_load_n(&q->__enq_event, __ATOMIC_SEQ_CST);
+
+      ok = q_mpmc_try_enq(q, elem);
+
+      if(!ok && !__q_sleep(&q->__enq_event, seen,
+                           (timeout_ns > 0 ? &deadline : NULL))) {
+         __atomic_sub_fetch(&q->__enq_waiters, 1, __ATOMIC_SEQ_CST);
+         return 0;
+      }
+
+      __atomic_sub_fetch(&q->__enq_waiters, 1, __ATOMIC_SEQ_CST);
+   } while(!ok);
+
+   return 1;
+}
+
+
+/**
+ * Copies the head of a multi-producer, multi-consumer queue into a buffer and
+ * removes it, waiting for an element if the queue is empty. See
+ * q_mpmc_enq_wait(...).
+ *
+ * @param q - the queue to remove the element from.
+ * @param out - a buffer of at least the queue's element size.
+ * @param timeout_ns - the longest to wait, in nanoseconds; negative to wait
+ *    for as long as it takes, 0 (zero) not to sleep.
+ * @return 1 if an element was removed. Returns 0 if either pointer is NULL or
+ *    the queue stayed empty until the timeout.
+ **/
+int q_mpmc_deq_wait(q_mpmc_t* const q, void* const out, long timeout_ns) {
+   struct timespec deadline;
+   int i, ok, seen;
+
+   if(!q || !out) return 0;
+
+   for(i = 0; i < SPIN_TRIES; i++)
+      if(q_mpmc_try_deq(q, out)) return 1;
+
+   if(!timeout_ns) return 0;
+
+   if(timeout_ns > 0) {
+      clock_gettime(CLOCK_MONOTONIC, &deadline);
+      deadline.tv_sec += timeout_ns / 1000000000L;
+      deadline.tv_nsec += timeout_ns % 1000000000L;
+   }
+
+   do {
+      __atomic_add_fetch(&q->__deq_waiters, 1, __ATOMIC_SEQ_CST);
+      seen = __atomic_load_n(&q->__deq_event, __ATOMIC_SEQ_CST);
+
+      ok = q_mpmc_try_deq(q, out);
+
+      if(!ok && !__q_sleep(&q->__deq_event, seen,
+                           (timeout_ns > 0 ? &deadline : NULL))) {
+         __atomic_sub_fetch(&q->__deq_waiters, 1, __ATOMIC_SEQ_CST);
+         return 0;
+      }
+
+      __atomic_sub_fetch(&q->__deq_waiters, 1, __ATOMIC_SEQ_CST);
+   } while(!ok);
+
+   return 1;
+}
+
+
+/**
+ * Wake threads sleeping on an event, if any have announced a wait. The fence
+ * orders the caller's change to the queue before the check of the waiters,
+ * matching a waiter's announcement before its last attempt: either the
+ * waiter sees the change or the waker sees the waiter. With nobody waiting
+ * this makes no system call.
+ *
+ * @param event - the event to bump.
+ * @param waiters - the count of threads waiting on it.
+ * @param n - the most threads to wake.
+ **/
+static void __q_wake(int* const event, int* const waiters, int n) {
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+   if(!__atomic_load_n(waiters, __ATOMIC_RELAXED)) return;
+
+   __atomic_add_fetch(event, 1, __ATOMIC_SEQ_CST);
+
+#ifdef __linux__
+   syscall(SYS_futex, event, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+#else
+   (void) n;
+#endif
 }
 
+
+/**
+ * Sleep until an event is bumped past a value seen, the deadline passes, or
+ * the sleep is cut short. Callers retry whatever they waited for after each
+ * sleep, so an early return is harmless.
+ *
+ * @param event - the event to wait on.
+ * @param seen - the value of the event before the caller's last attempt.
+ * @param deadline - when to give up, on the monotonic clock; NULL for never.
+ * @return 1 if the caller should try again. Returns 0 if the deadline has
+ *    passed.
+ **/
+static int __q_sleep(int* const event, int seen,
+                     const struct timespec* const deadline) {
+   struct timespec now, left;
+
+   left.tv_sec = 0;
+   left.tv_nsec = POLL_NS;
+
+   if(deadline) {
+      clock_gettime(CLOCK_MONOTONIC, &now);
+
+      left.tv_sec = deadline->tv_sec - now.tv_sec;
+      left.tv_nsec = deadline->tv_nsec - now.tv_nsec;
+
+      for(; left.tv_nsec < 0; left.tv_sec--)
+         left.tv_nsec += 1000000000L;
+      for(; left.tv_nsec >= 1000000000L; left.tv_sec++)
+         left.tv_nsec -= 1000000000L;
+
+      if(left.tv_sec < 0) return 0;
+   }
+
+#ifdef __linux__
+   syscall(SYS_futex, event, FUTEX_WAIT_PRIVATE, seen,
+           (deadline ? &left : NULL), NULL, 0);
+#else
+   (void) event;
+   (void) seen;
+
+   if(!deadline || left.tv_sec > 0 || left.tv_nsec > POLL_NS) {
+      left.tv_sec = 0;
+      left.tv_nsec = POLL_NS;
+   }
+
+   nanosleep(&left, NULL);
+#endif
+
+   return 1;
+}
@@ -17,15 +17,39 @@
  * along with this program.  If not, see {http://www.gnu.org/licenses/}.
  **/
 #include <stdlib.h>
+#include <string.h>     /* For memcpy */
 #include "dstructs.h"
 
 
+#define ARRAY_MIN 16       /* Fewest slots in an array stack */
+#define CHUNK_SLOTS 1024   /* Default slots per chunk of a segmented stack */
+
+
+/**
+ * A block of slots; the slots follow the header, which is padded so that
+ * they are aligned as malloc(...) would align them.
+ **/
+typedef union __s_chunk_u {
+   union __s_chunk_u *prev;   /* Chunk below this one, if segmented */
+   long double align;
+} __s_chunk_t;
+
+
 /**
  * Stack public, opaque data type. Contents only accessable through function
  * calls.
  **/
 struct stack_s {
-   llist_t *__list;
+   llist_t *__list;        /* NULL if the stack is array-backed */
+   __s_chunk_t *__chunk;   /* The array, or the chunk holding the top */
+   __s_chunk_t *__reserve; /* Emptied chunk kept for the next push */
+   size_t __top;           /* Slots in use in __chunk */
+   size_t __cap;           /* Slots in __chunk */
+   size_t __count;
+   size_t __slot;
+   size_t __elem_size;
+   int __byval;            /* Nonzero if elements are held, not pointers */
+   int __segmented;
 };
 
 
@@ -34,6 +58,21 @@ struct stack_s {
 #define s_empty(S) (!s_top(S))
 
 
+/* Local functions */
+static stack_t* __s_create(llist_t* const list, size_t elem_size,
+                           int is_inline);
+static stack_t* __s_block(size_t elem_size, int cap, int is_inline,
+                          int segmented);
+static int      __s_grow(stack_t* const s);
+static void*    __s_drop(stack_t* const s);
+static void*    __s_copy(void* const dst, const void* src, size_t size);
+
+
+/* Slot N of a chunk, and the element or pointer it holds */
+#define __SLOT(S, C, N) ((char*) ((C) + 1) + (N) * (S)->__slot)
+#define __VALUE(S, P) ((S)->__byval ? (void*) (P) : *(void**) (P))
+
+
 /**
  * A simulated constructor for a stack.
  *
@@ -46,19 +85,179 @@ struct stack_s {
  *    error.
  **/
 stack_t* __s_init(size_t __elem_size) {
+   return __s_create(__ll_init(__elem_size), __elem_size, 0);
+}
+
+
+/**
+ * A simulated constructor for an inline stack, which copies each element
+ * into its node on s_push(...) rather than storing the pointer. Copy elements
+ * out with s_pop_into(...); s_pop(...) returns a copy held by the stack,
+ * valid until the next pop. See ll_init_inline(...).
+ *
+ * NOTE: This is a function that is not intended for use by the user. The user
+ * should instead use the macro s_init_inline(type).
+ *
+ * @param __elem_size - the size of an element in the stack.
+ * @return a pointer to an empty stack. Returns a NULL pointer upon allocation
+ *    error.
+ **/
+stack_t* __s_init_inline(size_t __elem_size) {
+   return __s_create(__ll_init_inline(__elem_size), __elem_size, 1);
+}
+
+
+/**
+ * A simulated constructor for an array stack, which keeps pointers to its
+ * elements in one contiguous array that doubles when full. Pushing and
+ * popping allocate nothing until the array must grow.
+ *
+ * NOTE: This is a function that is not intended for use by the user. The user
+ * should instead use the macro s_init_array(type, cap).
+ *
+ * @param __elem_size - the size of an element in the stack.
+ * @param cap - the initial capacity; 0 (zero) picks a small default.
+ * @return a pointer to an empty stack. Returns a NULL pointer if cap is
+ *    negative or upon allocation error.
+ **/
+stack_t* __s_init_array(size_t __elem_size, int cap) {
+   return __s_block(__elem_size, cap, 0, 0);
+}
+
+
+/**
+ * A simulated constructor for an inline array stack, whose slots hold copies
+ * of the elements. s_pop(...) returns a pointer to the popped slot, valid
+ * until the next push.
+ *
+ * NOTE: This is a function that is not intended for use by the user. The user
+ * should instead use the macro s_init_array_inline(type, cap).
+ *
+ * @param __elem_size - the size of an element in the stack.
+ * @param cap - the initial capacity; 0 (zero) picks a small default.
+ * @return a pointer to an empty stack. Returns a NULL pointer if cap is
+ *    negative or upon allocation error.
+ **/
+stack_t* __s_init_array_inline(size_t __elem_size, int cap) {
+   return __s_block(__elem_size, cap, 1, 0);
+}
+
+
+/**
+ * A simulated constructor for a segmented stack, which chains fixed-size
+ * chunks of slots instead of growing one array, so that no push ever copies
+ * the elements already pushed. The last chunk emptied is kept for reuse, so
+ * pushing and popping across a chunk boundary allocates nothing.
+ *
+ * NOTE: This is a function that is not intended for use by the user. The user
+ * should instead use the macro s_init_segmented(type, chunk).
+ *
+ * @param __elem_size - the size of an element in the stack.
+ * @param chunk - the slots per chunk; 0 (zero) picks a default.
+ * @return a pointer to an empty stack. Returns a NULL pointer if chunk is
+ *    negative or upon allocation error.
+ **/
+stack_t* __s_init_segmented(size_t __elem_size, int chunk) {
+   return __s_block(__elem_size, chunk, 0, 1);
+}
+
+
+/**
+ * A simulated constructor for an inline segmented stack, whose slots hold
+ * copies of the elements. s_pop(...) returns a pointer to the popped slot,
+ * valid until the next push or pop.
+ *
+ * NOTE: This is a function that is not intended for use by the user. The user
+ * should instead use the macro s_init_segmented_inline(type, chunk).
+ *
+ * @param __elem_size - the size of an element in the stack.
+ * @param chunk - the slots per chunk; 0 (zero) picks a default.
+ * @return a pointer to an empty stack. Returns a NULL pointer if chunk is
+ *    negative or upon allocation error.
+ **/
+stack_t* __s_init_segmented_inline(size_t __elem_size, int chunk) {
+   return __s_block(__elem_size, chunk, 1, 1);
+}
+
+
+/**
+ * Wrap a new list in a stack, freeing the list if the stack cannot be
+ * allocated.
+ *
+ * @param list - the list to wrap; may be NULL.
+ * @param elem_size - the size of an element in the list.
+ * @param is_inline - nonzero if the list is inline.
+ * @return a pointer to an empty stack. Returns a NULL pointer if the list is
+ *    NULL or upon allocation error.
+ **/
+static stack_t* __s_create(llist_t* const list, size_t elem_size,
+                           int is_inline) {
+   stack_t *stack;
+
+   if(!list) return NULL;
+
+   stack = malloc(sizeof(stack_t));
+
+   if(!stack) {
+      ll_free(list);
+      return NULL;
+   }
+
+   stack->__list = list;
+   stack->__chunk = NULL;
+   stack->__reserve = NULL;
+   stack->__top = 0;
+   stack->__cap = 0;
+   stack->__count = 0;
+   stack->__slot = 0;
+   stack->__elem_size = elem_size;
+   stack->__byval = is_inline;
+   stack->__segmented = 0;
+
+   return stack;
+}
+
+
+/**
+ * Allocate and initialize an empty array or segmented stack.
+ *
+ * @param cap - the slots in the array, or in each chunk.
+ * @param is_inline - nonzero for slots holding elements, zero (0) for slots
+ *    holding pointers.
+ * @param segmented - nonzero to chain chunks rather than grow the array.
+ * @return a pointer to an empty stack. Returns a NULL pointer if cap is
+ *    negative or upon allocation error.
+ **/
+static stack_t* __s_block(size_t elem_size, int cap, int is_inline,
+                          int segmented) {
    stack_t *stack;
 
+   if(cap < 0) return NULL;
+
    stack = malloc(sizeof(stack_t));
 
    if(!stack) return NULL;
 
-   stack->__list = __ll_init(__elem_size);
+   stack->__list = NULL;
+   stack->__reserve = NULL;
+   stack->__top = 0;
+   stack->__cap = (cap ? (size_t) cap : (segmented ? CHUNK_SLOTS : ARRAY_MIN));
+   stack->__count = 0;
+   stack->__slot = (is_inline ? elem_size : sizeof(void*));
+   stack->__elem_size = elem_size;
+   stack->__byval = is_inline;
+   stack->__segmented = segmented;
+
+   stack->__chunk = malloc(sizeof(__s_chunk_t) +
+                           stack->__cap * stack->__slot);
 
-   if(!stack->__list) {
+   if(!stack->__chunk) {
       free(stack);
       return NULL;
    }
 
+   stack->__chunk->prev = NULL;
+
    return stack;
 }
 
@@ -69,8 +268,24 @@ stack_t* __s_init(size_t __elem_size) {
  * @param s - the stack to destroy.
  **/
 void s_free(stack_t* const s) {
+   __s_chunk_t *chunk;
+
    if(!s) return;
 
+   /* As with a list, elements still pointed to are freed */
+   if(!s->__list) {
+      while(!s->__byval && s->__count)
+         free(__s_drop(s));
+
+      while(s->__chunk) {
+         chunk = s->__chunk;
+         s->__chunk = chunk->prev;
+         free(chunk);
+      }
+
+      free(s->__reserve);
+   }
+
    ll_free(s->__list);
    free(s);
 }
@@ -84,7 +299,9 @@ void s_free(stack_t* const s) {
  *    NULL.
  **/
 int s_size(stack_t* const s) {
-   return (s ? ll_size(s->__list) : -1);
+   if(!s) return -1;
+
+   return (s->__list ? ll_size(s->__list) : (int) s->__count);
 }
 
 
@@ -98,7 +315,15 @@ int s_size(stack_t* const s) {
  *    NULL if the stack is NULL.
  **/
 void* s_top(stack_t* const s) {
-   return (s ? ll_first(s->__list) : NULL);
+   if(!s) return NULL;
+
+   if(!s->__list) {
+      if(!s->__count) return NULL;
+
+      return __VALUE(s, __SLOT(s, s->__chunk, s->__top - 1));
+   }
+
+   return ll_first(s->__list);
 }
 
 
@@ -112,6 +337,19 @@ void* s_top(stack_t* const s) {
 void s_push(stack_t* const s, void* const elem) {
    if(!s || !elem) return;
 
+   if(!s->__list) {
+      if(s->__top == s->__cap && !__s_grow(s)) return;
+
+      if(s->__byval)
+         __s_copy(__SLOT(s, s->__chunk, s->__top), elem, s->__elem_size);
+      else
+         *(void**) __SLOT(s, s->__chunk, s->__top) = elem;
+
+      s->__top++;
+      s->__count++;
+      return;
+   }
+
    ll_addf(s->__list, elem);
 }
 
@@ -123,7 +361,131 @@ void s_push(stack_t* const s, void* const elem) {
  * @return the top of the stack. Returns NULL if the stack is empty or NULL.
  **/
 void* s_pop(stack_t* const s) {
-   return (s ? ll_remf(s->__list) : NULL);
+   if(!s) return NULL;
+
+   if(!s->__list) return (s->__count ? __s_drop(s) : NULL);
+
+   return ll_remf(s->__list);
+}
+
+
+/**
+ * Removes the top of the stack, copying it into a buffer. See
+ * ll_rem_into(...).
+ *
+ * @param s - the stack to retrieve the element from.
+ * @param out - a buffer of at least the stack's element size.
+ * @return 1 if an element was removed. Returns 0 if either pointer is NULL or
+ *    the stack is empty.
+ **/
+int s_pop_into(stack_t* const s, void* const out) {
+   if(!s) return 0;
+
+   if(!s->__list) {
+      if(!out || !s->__count) return 0;
+
+      __s_copy(out, __s_drop(s), s->__elem_size);
+      return 1;
+   }
+
+   return ll_remf_into(s->__list, out);
+}
+
+
+/**
+ * Pushes the elements of an array onto the stack, in order, so that the last
+ * of them ends up on top. The array holds what the stack holds: elements for
+ * an inline stack, and pointers to elements otherwise.
+ *
+ * @param s - the stack to push the elements onto.
+ * @param elems - an array of n elements, or of n pointers to elements.
+ * @param n - the number of elements to push.
+ * @return the number of elements pushed, from the front of the array; fewer
+ *    than n only upon allocation error or, for pointers, at a NULL one.
+ *    Returns 0 if either pointer is NULL or n is not positive.
+ **/
+int s_push_n(stack_t* const s, const void* const elems, int n) {
+   const char *src;
+   void *elem;
+   size_t room;
+   int i;
+
+   if(!s || !elems || n <= 0) return 0;
+
+   src = elems;
+
+   /* Fill the array or chunk a block at a time */
+   if(!s->__list) {
+      if(!s->__byval)
+         for(i = 0; i < n; i++)
+            if(!((void* const*) elems)[i]) n = i;
+
+      for(i = 0; i < n; i += room) {
+         if(s->__top == s->__cap && !__s_grow(s)) break;
+
+         room = s->__cap - s->__top;
+
+         if(room > (size_t) (n - i)) room = n - i;
+
+         memcpy(__SLOT(s, s->__chunk, s->__top), src + i * s->__slot,
+                room * s->__slot);
+
+         s->__top += room;
+         s->__count += room;
+      }
+
+      return i;
+   }
+
+   for(i = 0; i < n; i++) {
+      elem = (s->__byval ? (void*) (src + i * s->__elem_size) :
+                           ((void* const*) elems)[i]);
+
+      if(!elem || !ll_add(s->__list, 0, elem)) break;
+   }
+
+   return i;
+}
+
+
+/**
+ * Pops up to n elements off the stack into an array, top first, as though by
+ * s_pop(...) on each. The array is filled with what the stack holds: elements
+ * for an inline stack, which are copied out as by s_pop_into(...), and
+ * pointers to elements otherwise.
+ *
+ * @param s - the stack to pop the elements from.
+ * @param out - an array with room for n elements, or for n pointers.
+ * @param n - the most elements to pop.
+ * @return the number of elements popped. Returns 0 if either pointer is NULL,
+ *    n is not positive, or the stack is empty.
+ **/
+int s_pop_n(stack_t* const s, void* const out, int n) {
+   char *dst;
+   int i;
+
+   if(!s || !out || n <= 0) return 0;
+
+   dst = out;
+
+   if(!s->__list) {
+      for(i = 0; i < n && s->__count; i++) {
+         __s_copy(dst + i * s->__slot, __SLOT(s, s->__chunk, s->__top - 1),
+                  s->__slot);
+         __s_drop(s);
+      }
+
+      return i;
+   }
+
+   for(i = 0; i < n && ll_size(s->__list); i++) {
+      if(s->__byval)
+         ll_remf_into(s->__list, dst + i * s->__elem_size);
+      else
+         ((void**) out)[i] = ll_remf(s->__list);
+   }
+
+   return i;
 }
 
 
@@ -136,6 +498,107 @@ void* s_pop(stack_t* const s) {
  *    the stack is NULL.
  **/
 void** s_toarr(stack_t* const s) {
-   return (s ? ll_toarr(s->__list) : NULL);
+   __s_chunk_t *chunk;
+   void **array;
+   size_t i, top;
+
+   if(!s) return NULL;
+
+   if(!s->__list) {
+      array = malloc(sizeof(void*) * s->__count);
+
+      if(!array) return NULL;
+
+      chunk = s->__chunk;
+      top = s->__top;
+
+      /* From the top down, as a list-backed stack is ordered */
+      for(i = 0; i < s->__count; i++) {
+         if(!top) {
+            chunk = chunk->prev;
+            top = s->__cap;
+         }
+
+         array[i] = __VALUE(s, __SLOT(s, chunk, --top));
+      }
+
+      return array;
+   }
+
+   return ll_toarr(s->__list);
 }
 
+
+/**
+ * Make room for a push onto a full array or chunk. An array doubles in
+ * place; a segmented stack moves up to the reserve chunk, or a new one.
+ *
+ * @return 1 if there is room. Returns 0 upon allocation error.
+ **/
+static int __s_grow(stack_t* const s) {
+   __s_chunk_t *chunk;
+
+   if(!s->__segmented) {
+      chunk = realloc(s->__chunk,
+                      sizeof(__s_chunk_t) + 2 * s->__cap * s->__slot);
+
+      if(!chunk) return 0;
+
+      s->__chunk = chunk;
+      s->__cap *= 2;
+      return 1;
+   }
+
+   chunk = s->__reserve;
+   s->__reserve = NULL;
+
+   if(!chunk) chunk = malloc(sizeof(__s_chunk_t) + s->__cap * s->__slot);
+
+   if(!chunk) return 0;
+
+   chunk->prev = s->__chunk;
+   s->__chunk = chunk;
+   s->__top = 0;
+
+   return 1;
+}
+
+
+/**
+ * Pop the top of a nonempty array or segmented stack. A chunk left empty
+ * becomes the reserve, so the popped slot stays valid until the next push or
+ * pop, and the old reserve is freed.
+ *
+ * @return the popped element, or the popped slot if the stack is inline.
+ **/
+static void* __s_drop(stack_t* const s) {
+   void *slot;
+
+   slot = __SLOT(s, s->__chunk, --s->__top);
+   s->__count--;
+
+   if(!s->__top && s->__chunk->prev) {
+      free(s->__reserve);
+      s->__reserve = s->__chunk;
+      s->__chunk = s->__chunk->prev;
+      s->__top = s->__cap;
+   }
+
+   return __VALUE(s, slot);
+}
+
+
+/**
+ * Copy an element. Copies of the common sizes are fixed-size, which the
+ * compiler turns into plain loads and stores instead of a call.
+ *
+ * @return the destination.
+ **/
+static void* __s_copy(void* const dst, const void* src, size_t size) {
+   switch(size) {
+      case 4:  return memcpy(dst, src, 4);
+      case 8:  return memcpy(dst, src, 8);
+      case 16: return memcpy(dst, src, 16);
+      default: return memcpy(dst, src, size);
+   }
+}
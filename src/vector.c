@@ -16,30 +16,109 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see {http://www.gnu.org/licenses/}.
  **/
+#define _GNU_SOURCE     /* For mmap(...), mremap(...), ftruncate(...) */
+
 #include <stdlib.h>     /* For malloc(...), free(...) */
 #include <string.h>     /* For memcmp(...), memcpy(...) */
+#include <stdint.h>     /* For int32_t, uint64_t, ... */
 #include "dstructs.h"
 
+/* File-backed vectors need POSIX memory mapping */
+#if defined(__unix__) || defined(__APPLE__)
+#define V_MAP 1
+#include <fcntl.h>      /* For open(...) */
+#include <sys/mman.h>   /* For mmap(...), msync(...), munmap(...) */
+#include <sys/stat.h>   /* For fstat(...) */
+#endif
+
+/* Vectorized search kernels are only built for x86 with GCC-style builtins */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define V_SIMD 1
+#include <immintrin.h>  /* For SSE2, AVX2, AVX-512 intrinsics */
+#endif
+
 #define INIT_SIZE 10
+#define RING_INIT_SIZE 16     /* Ring capacities are powers of two */
 #define ADDED 1
 #define EXIST 1
 
+/* Storage flags */
+#define V_INLINE 0x1    /* Elements are stored by value in the buffer */
+#define V_RING   0x2    /* Buffer is circular, starting at __head */
+#define V_SORTED 0x4    /* Elements are kept ordered by __cmp */
+#define V_MAPPED 0x8    /* Elements live in a memory-mapped file */
+
+#define MAP_MAGIC "DSVECT01"  /* Identifies a file-backed vector */
+
+#define SORT_CUTOFF 16     /* Runs shorter than this are insertion sorted */
+#define RADIX_CUTOFF 64    /* Runs shorter than this are not radix sorted */
+
 
 /* Local functions */
-static void __v_expand(vect_t* const v);
+static vect_t* __v_create(size_t __elem_size, int flags, int cap);
+static int  __v_resize(vect_t* const v, int cap);
+static int  __v_expand(vect_t* const v);
+static char* __v_slot(vect_t* const v, int index);
+static void* __v_elem(vect_t* const v, int index);
+static void __v_move(vect_t* const v, int dst, int src, int n);
+static void __v_copyin(vect_t* const v, int index, const char *elems, int n);
+static int  __v_linearize(vect_t* const v);
+static int  __v_remap(vect_t* const v, int cap);
+static int  __v_bound(vect_t* const v, int (*cmp)(const void*, const void*),
+                      const void *elem, int upper);
+static int  __v_compare(vect_t* const v,
+                        int (*cmp)(const void*, const void*),
+                        const void *a, const void *b);
+static int  __v_filter(vect_t* const v, int (*pred)(void* const, void*),
+                       void* ctx, void (*funct)(void* const), int keep);
+static int  __v_find(vect_t* const v, void* const elem);
 
 
 /**
- * Internal vector definition.
+ * Internal vector definition. Elements live in a single buffer of slots. A
+ * slot holds either a pointer to an element (the default) or, for vectors
+ * created with v_init_inline(...), the bytes of the element itself. Ring
+ * vectors treat the buffer as circular: element i lives in slot
+ * ((__head + i) & (__cap - 1)), and __cap is kept a power of two.
  **/
 struct __vect_s {
-   int **__elements;
+   char *__data;
+   void *__spare;       /* Copy of the last element removed (inline only) */
    size_t __elem_size;
+   size_t __slot_size;
    int __cap;
    int __size;
+   int __head;          /* Slot of the first element (ring only) */
+   int __flags;
+   int (*__cmp)(const void*, const void*);   /* Ordering (sorted only) */
+   int __fd;            /* Backing file (mapped only) */
 };
 
 
+/**
+ * Header at the start of the file behind a file-backed vector. The elements
+ * follow it, so they start on a cache line within the mapping.
+ **/
+typedef struct __v_mhdr_s {
+   char magic[8];
+   uint64_t elem_size;
+   uint64_t size;
+   char reserved[40];
+} __v_mhdr_t;
+
+
+/**
+ * Internal ordering of a run of slots, used while sorting.
+ **/
+typedef struct __v_ord_s {
+   int (*cmp)(const void*, const void*);
+   size_t elem_size;
+   size_t slot_size;
+   int byval;
+   char *pivot;         /* Scratch slot */
+} __v_ord_t;
+
+
 /**
  * Internal vector iterator definition.
  **/
@@ -63,37 +142,143 @@ struct __v_itr_s {
  *    error.
  **/
 vect_t* __v_init(size_t __elem_size) {
+   return __v_create(__elem_size, 0, INIT_SIZE);
+}
+
+
+/**
+ * A simulated constructor for a vector with a given initial capacity. Use
+ * this when the number of elements is known up front to avoid reallocating
+ * while the vector is filled.
+ *
+ * NOTE: This is a function that is not intended for use by the user. The user
+ * should instead use the macro v_init_cap(type, cap), where type is the type
+ * that the user wishes to restrict the vector to.
+ *
+ * @param __elem_size - the size of an element in the vector.
+ * @param cap - the initial capacity of the vector.
+ * @return a pointer to an empty vector. Returns a NULL pointer upon allocation
+ *    error or if the capacity is less than one (1).
+ **/
+vect_t* __v_init_cap(size_t __elem_size, int cap) {
+   if(cap < 1) return NULL;
+
+   return __v_create(__elem_size, 0, cap);
+}
+
+
+/**
+ * A simulated constructor for a by-value vector. Elements are copied into
+ * one contiguous buffer, back to back, instead of being stored as pointers to
+ * separately allocated elements. Pointers returned by v_get(...) and friends
+ * point into that buffer and are only valid until the vector is next
+ * modified.
+ *
+ * NOTE: This is a function that is not intended for use by the user. The user
+ * should instead use the macro v_init_inline(type), where type is the type
+ * that the user wishes to restrict the vector to.
+ *
+ * @param __elem_size - the size of an element in the vector.
+ * @return a pointer to an empty vector. Returns a NULL pointer upon allocation
+ *    error.
+ **/
+vect_t* __v_init_inline(size_t __elem_size) {
+   return __v_create(__elem_size, V_INLINE, INIT_SIZE);
+}
+
+
+/**
+ * A simulated constructor for a ring vector. The buffer is used as a circular
+ * array, so adding and removing at either end of the vector is amortized
+ * O(1) while v_get(...) remains O(1).
+ *
+ * NOTE: This is a function that is not intended for use by the user. The user
+ * should instead use the macros v_init_ring(type) and v_init_ring_inline(type),
+ * where type is the type that the user wishes to restrict the vector to.
+ *
+ * @param __elem_size - the size of an element in the vector.
+ * @param by_value - nonzero to store elements by value, as v_init_inline(...)
+ *    does.
+ * @return a pointer to an empty vector. Returns a NULL pointer upon allocation
+ *    error.
+ **/
+vect_t* __v_init_ring(size_t __elem_size, int by_value) {
+   return __v_create(__elem_size, V_RING | (by_value ? V_INLINE : 0),
+                     RING_INIT_SIZE);
+}
+
+
+/**
+ * Allocates and initializes a vector with the given storage flags.
+ *
+ * @param __elem_size - the size of an element in the vector.
+ * @param flags - the storage flags of the vector.
+ * @param cap - the initial capacity of the vector.
+ * @return a pointer to an empty vector. Returns a NULL pointer upon allocation
+ *    error.
+ **/
+static vect_t* __v_create(size_t __elem_size, int flags, int cap) {
    vect_t *vector;
 
    vector = malloc(sizeof(vect_t));
 
    if(!vector) return NULL;
 
-   vector->__elements = calloc(INIT_SIZE, sizeof(void*));
+   vector->__elem_size = __elem_size;
+   vector->__slot_size = (flags & V_INLINE ? __elem_size : sizeof(void*));
+   vector->__spare = NULL;
+   vector->__data = malloc((size_t) cap * vector->__slot_size);
+
+   if(flags & V_INLINE)
+      vector->__spare = malloc(__elem_size);
 
-   if(!vector->__elements) {
+   if(!vector->__data || ((flags & V_INLINE) && !vector->__spare)) {
+      free(vector->__data);
+      free(vector->__spare);
       free(vector);
       return NULL;
    }
 
-   vector->__elem_size = __elem_size;
-   vector->__cap = INIT_SIZE;
+   vector->__cap = cap;
    vector->__size = 0;
+   vector->__head = 0;
+   vector->__flags = flags;
+   vector->__cmp = V_CMP_MEM;
+   vector->__fd = -1;
 
    return vector;
 }
 
 
 /**
- * A simulated destructor for a vector.
+ * A simulated destructor for a vector. A file-backed vector is flushed to its
+ * file and unmapped; its elements remain in the file.
  *
  * @param v - the vector to destroy.
  **/
 void v_free(vect_t* const v) {
    if(!v) return;
 
+   /* File-backed vectors keep their elements in the file */
+   if(v->__flags & V_MAPPED) {
+#ifdef V_MAP
+      /* A vector whose mapping was lost has nothing left to sync or unmap */
+      if(v->__data) {
+         v_sync(v);
+         munmap(v->__data - sizeof(__v_mhdr_t),
+                sizeof(__v_mhdr_t) + (size_t) v->__cap * v->__slot_size);
+      }
+
+      close(v->__fd);
+#endif
+      free(v->__spare);
+      free(v);
+      return;
+   }
+
    v_clear(v);          /* Remove elements in vector */
-   free(v->__elements);
+   free(v->__data);
+   free(v->__spare);
    free(v);
 }
 
@@ -121,455 +306,2005 @@ int v_cap(vect_t* const v) {
 
 
 /**
- * If a vector is full, expand it by a factor of 2 times its capacity plus 1.
- * In other words expand by ((2 * v->__cap) + 1).
+ * Retrieve the raw storage of a vector. For a vector created with
+ * v_init_inline(...) this is the contiguous array of elements; otherwise it is
+ * the array of element pointers. The pointer is only valid until the vector
+ * is next modified. The elements of a ring vector are first moved so that
+ * they start at the beginning of the buffer.
  *
- * @param v - the vector to expand.
+ * @param v - the vector to retrieve the storage of.
+ * @return a pointer to the first slot of the vector. Returns NULL if the
+ *    vector is NULL or upon allocation error.
  **/
-static void __v_expand(vect_t* const v) {
-   v->__cap <<= 1;
-   v->__cap++;
+void* v_data(vect_t* const v) {
+   if(!v) return NULL;
 
-   v->__elements = realloc(v->__elements, v->__cap * sizeof(void*));
+   if(!__v_linearize(v)) return NULL;
+
+   return v->__data;
 }
 
 
 /**
- * Adds the specified element at the specified index in the vector. Shifts
- * remaining elements right one position (incrementing indices).
+ * Ensure that a vector can hold at least the specified number of elements
+ * without reallocating.
  *
- * @param v - the vector to add the specified element to.
- * @param index - the index to insert the specified element.
- * @param elem - the specified element to add to the vector.
- * @return 1 if the element is added to the vector. Return 0 if the vector is
- *    NULL, or if the specified index is less than zero (0) or larger than the
- *    size of the vector.
+ * @param v - the vector to reserve space in.
+ * @param cap - the number of elements the vector must be able to hold.
+ * @return 1 if the vector can hold cap elements. Returns 0 if the vector is
+ *    NULL or upon allocation error, in which case the vector is left
+ *    untouched.
  **/
-int v_add(vect_t* const v, int index, void* const elem) {
-   int i, size;
-
+int v_reserve(vect_t* const v, int cap) {
    if(!v) return !ADDED;
 
-   if(index < 0 || index > v->__size)
-      return !ADDED;
-
-   size = ++v->__size;
-
-   if(size == v->__cap)
-      __v_expand(v);
-
-   /* Move elements right one position */
-   for(i = size; i > index; i--)
-      v->__elements[i] = v->__elements[i - 1];
-
-   v->__elements[index] = elem;
+   if(cap <= v->__cap) return ADDED;
 
-   return ADDED;
+   return __v_resize(v, cap);
 }
 
 
 /**
- * Add a specified element to the front of this vector.
+ * Reallocate the storage of a vector to hold exactly the specified number of
+ * elements. Ring vectors are rounded up to a power of two, and elements that
+ * wrapped around the end of the old buffer are moved to stay in order.
  *
- * @param v - the vector to add the specified element to.
- * @param elem - the element to add to the vector.
+ * @param v - the vector to resize.
+ * @param cap - the new capacity; not less than the size of the vector.
+ * @return 1 if the vector was resized. Returns 0 upon allocation error, in
+ *    which case the vector is left untouched.
  **/
-void v_addf(vect_t* const v, void* const elem) {
-   v_add(v, 0, elem);
-}
-
+static int __v_resize(vect_t* const v, int cap) {
+   size_t slot_size;
+   char *data;
+   int old, wrap;
 
-/**
- * Add a specified element to the end of this vector.
- *
- * @param v - the vector to add the specified element to.
- * @param elem - the element to add to the vector.
- **/
-void v_addl(vect_t* const v, void* const elem) {
-   if(!v) return;
+   slot_size = v->__slot_size;
+   old = v->__cap;
 
-   v_add(v, v->__size, elem);
-}
+   if(v->__flags & V_MAPPED)
+      return __v_remap(v, cap);
 
+   if(v->__flags & V_RING) {
+      for(cap = (cap > 1 ? cap - 1 : 0), wrap = 1; cap; cap >>= 1)
+         wrap <<= 1;
+      cap = wrap;
 
-/**
- * Attempts to remove all elements in the specified vector. Applies free(...)
- * to each element in a vector and sets the size of the vector to 0.
- *
- * @param v - the vector to clear.
- **/
-void v_clear(vect_t* const v) {
-   v_apply(v, free);
-}
+      /* Shrinking; gather the elements at the front of the buffer first */
+      if(cap < old && !__v_linearize(v))
+         return !ADDED;
+   }
 
+   data = realloc(v->__data, (size_t) (cap ? cap : 1) * slot_size);
 
-/**
- * Determines if the specified element is contained within this vector.
- *
- * @param v - the vector possibly containing the specified element.
- * @param elem - the element possibly contained within the specified vector.
- * @return 1 if the element exists in the specified vector. Returns 0 otherwise
- *    or if the list is NULL;
- **/
-int v_contains(vect_t* const v, void* const elem) {
-   size_t num_bytes;
-   int i, size;
+   if(!data) return !ADDED;
 
-   if(!v) return !EXIST;
+   v->__data = data;
+   v->__cap = cap;
 
-   num_bytes = v->__elem_size;
-   size = v->__size;
+   /* Unwrap; the grown ring is at least twice the old one */
+   if((v->__flags & V_RING) && cap > old) {
+      wrap = v->__head + v->__size - old;
 
-   /* Loop through to find the element */
-   for(i = 0; i < size; i++)
-      if(memcmp(elem, v->__elements[i], num_bytes) == 0)
-         return EXIST;
+      if(wrap > 0)
+         memcpy(data + (size_t) old * slot_size, data, (size_t) wrap * slot_size);
+   }
 
-   /* Element does not exist */
-   return !EXIST;
+   return ADDED;
 }
 
 
 /**
- * Retrieves (but does not remove) the element at the specified index in
- * the vector.
+ * If a vector is full, expand it by a factor of 2 times its capacity plus 1.
+ * In other words expand by ((2 * v->__cap) + 1). Ring vectors simply double.
  *
- * @param v - the vector to retrieve the element from.
- * @param index - the index in the specified vector to retrieve.
- * @return the element at the specified index. Returns 0 if the vector is NULL,
- *    if the index is less than zero (0), or if the index is greater than the
- *    size of the vector.
+ * @param v - the vector to expand.
+ * @return 1 if the vector was expanded. Returns 0 upon allocation error, in
+ *    which case the vector is left untouched.
  **/
-void* v_get(vect_t* const v, int index) {
-   if(!v) return NULL;
+static int __v_expand(vect_t* const v) {
+   if(v->__flags & V_RING)
+      return __v_resize(v, v->__cap << 1);
 
-   if(index < 0 || index >= v->__size)
-      return NULL;
-
-   return v->__elements[index];
+   return __v_resize(v, (v->__cap << 1) + 1);
 }
 
 
 /**
- * Retrieves (but does not remove) the first element in the specified vector.
+ * Retrieve the address of the slot holding a position in a vector.
  *
- * @param v - the vector to retrieve the element from.
- * @return the first element in the vector. Returns NULL if the vector is NULL
- *    or empty.
+ * @param v - the vector to retrieve the slot from.
+ * @param index - the position of the slot; may be one past the last element.
+ * @return the address of the slot at the specified position.
  **/
-void* v_first(vect_t* const v) {
-   return v_get(v, 0);
+static char* __v_slot(vect_t* const v, int index) {
+   if(v->__flags & V_RING)
+      index = (v->__head + index) & (v->__cap - 1);
+
+   return v->__data + (size_t) index * v->__slot_size;
 }
 
 
 /**
- * Retrieves (but does not remove) the last element in the specified vector.
+ * Retrieve the element stored at a position in a vector. For by-value
+ * vectors this is the address of the slot itself.
  *
  * @param v - the vector to retrieve the element from.
- * @return the last element in the vector. Returns NULL if the vector is NULL
- *    or empty.
+ * @param index - the position of the element; assumed to be valid.
+ * @return the element at the specified position.
  **/
-void* v_last(vect_t* const v) {
-   if(!v) return NULL;
+static void* __v_elem(vect_t* const v, int index) {
+   char *slot;
 
-   return v_get(v, v->__size - 1);
+   slot = __v_slot(v, index);
+
+   return (v->__flags & V_INLINE ? (void*) slot : *(void**) slot);
 }
 
 
 /**
- * Retrieve the index of the first occurrence of the specifed element in
- * the specified vector.
+ * Move a run of slots within a vector, as memmove(...) would. Runs in a ring
+ * vector are moved in pieces that do not wrap around the buffer.
  *
- * @param v - the vector to retreive the index from.
- * @param elem - the element to search for.
- * @return the index of the first occurrence of the specified element, or -1 if
- *    the vector is NULL or does not contain the specified element.
+ * @param v - the vector to move slots in.
+ * @param dst - the position to move the run to.
+ * @param src - the position of the first slot of the run.
+ * @param n - the number of slots to move.
  **/
-int v_indexof(vect_t* const v, void* const elem) {
-   size_t num_bytes;
-   int i, size;
+static void __v_move(vect_t* const v, int dst, int src, int n) {
+   size_t slot_size;
+   int mask, ps, pd, run;
 
-   if(!v) return -1;
+   slot_size = v->__slot_size;
 
-   num_bytes = v->__elem_size;
-   size = v->__size;
+   if(!(v->__flags & V_RING)) {
+      memmove(v->__data + (size_t) dst * slot_size,
+              v->__data + (size_t) src * slot_size, (size_t) n * slot_size);
+      return;
+   }
 
-   /* Look for first occurance */
-   for(i = 0; i < size; i++)
-      if(memcmp(elem, v->__elements[i], num_bytes) == 0)
-         return i;
+   mask = v->__cap - 1;
 
-   /* Element not found */
-   return -1;
+   /* Moving left; copy from the front of the run */
+   if(dst < src) {
+      while(n > 0) {
+         ps = (v->__head + src) & mask;
+         pd = (v->__head + dst) & mask;
+         run = n;
+
+         if(run > v->__cap - ps) run = v->__cap - ps;
+         if(run > v->__cap - pd) run = v->__cap - pd;
+
+         memmove(v->__data + (size_t) pd * slot_size,
+                 v->__data + (size_t) ps * slot_size, (size_t) run * slot_size);
+
+         src += run;
+         dst += run;
+         n -= run;
+      }
+   }
+
+   /* Moving right; copy from the back of the run */
+   else {
+      while(n > 0) {
+         ps = (v->__head + src + n - 1) & mask;
+         pd = (v->__head + dst + n - 1) & mask;
+         run = n;
+
+         if(run > ps + 1) run = ps + 1;
+         if(run > pd + 1) run = pd + 1;
+
+         memmove(v->__data + (size_t) (pd - run + 1) * slot_size,
+                 v->__data + (size_t) (ps - run + 1) * slot_size,
+                 (size_t) run * slot_size);
+
+         n -= run;
+      }
+   }
 }
 
 
 /**
- * Apply a function over all the elements in a vector.
+ * Copy a run of slots from an array into a vector.
  *
- * @param v - the vector to apply an operation over.
- * @param funct - the function to apply over the specified vector, where the
- *    argument to the function is an element in the vector.
+ * @param v - the vector to copy into.
+ * @param index - the position of the first slot to fill.
+ * @param elems - the slots to copy.
+ * @param n - the number of slots to copy.
  **/
-void v_apply(vect_t* const v, void (*funct)(void* const)) {
-   int i, size;
+static void __v_copyin(vect_t* const v, int index, const char *elems, int n) {
+   size_t slot_size;
+   int ps, run;
 
-   if(!v) return;
+   slot_size = v->__slot_size;
 
-   size = v->__size;
+   while(n > 0) {
+      ps = (int) ((__v_slot(v, index) - v->__data) / slot_size);
+      run = n;
 
-   /* For each element in the list */
-   for(i = 0; i < size; i++)
-      (funct)(v->__elements[i]);
+      if((v->__flags & V_RING) && run > v->__cap - ps)
+         run = v->__cap - ps;
 
-   if(funct == free)
-      v->__size = 0;
+      memcpy(v->__data + (size_t) ps * slot_size, elems,
+             (size_t) run * slot_size);
+
+      elems += (size_t) run * slot_size;
+      index += run;
+      n -= run;
+   }
 }
 
 
 /**
- * Removes the element at the specified index in the specified vector. Shifts
- * remaining elements left one position (decrementing indices).
+ * Move the elements of a ring vector to the start of its buffer, so that the
+ * buffer may be read as a plain array.
  *
- * @param v - the vector to remove the specified element from.
- * @param index - the index of the element to be removed.
- * @return 1 if the vector contained the specified element. Returns 0 if the
- *    vector is NULL or the index is less than zero (0) or the index is greater
- *    than the size of the vector.
+ * @param v - the vector to rearrange.
+ * @return 1 if the elements start at the beginning of the buffer. Returns 0
+ *    upon allocation error, in which case the vector is left untouched.
  **/
-void* v_rem(vect_t* const v, int index) {
-   void *target;
-   int i, size;
+static int __v_linearize(vect_t* const v) {
+   size_t slot_size;
+   char *data;
+   int first;
 
-   if(!v) return NULL;
+   if(!(v->__flags & V_RING) || !v->__head) return ADDED;
 
-   if(index < 0 || index >= v->__size)
-      return NULL;
+   slot_size = v->__slot_size;
+   first = v->__cap - v->__head;
 
-   /* Removing from empty list */
-   if(v_empty(v)) return NULL;
+   /* Not wrapped; slide the elements down */
+   if(first >= v->__size) {
+      memmove(v->__data, v->__data + (size_t) v->__head * slot_size,
+              (size_t) v->__size * slot_size);
+   }
 
-   size = v->__size;
-   target = v->__elements[index];
+   /* Wrapped; copy both pieces into a fresh buffer */
+   else {
+      data = malloc((size_t) v->__cap * slot_size);
 
-   /* Shift elements left one position */
-   for(i = index; i < size; i++)
-      v->__elements[i] = v->__elements[i + 1];
+      if(!data) return !ADDED;
 
-   v->__size--;
-   return target;
+      memcpy(data, v->__data + (size_t) v->__head * slot_size,
+             (size_t) first * slot_size);
+      memcpy(data + (size_t) first * slot_size, v->__data,
+             (size_t) (v->__size - first) * slot_size);
+
+      free(v->__data);
+      v->__data = data;
+   }
+
+   v->__head = 0;
+   return ADDED;
 }
 
 
+/** Search Kernels **/
+
 /**
- * Removes and returns the first element in the specified vector.
+ * Scan a run of contiguous, fixed-width elements for the first one equal to
+ * a given element, one element at a time.
  *
- * @param v - the vector to retrieve the element from.
- * @return the first element in the vector. Returns NULL if the list is empty
- *    or NULL.
+ * @param base - the first element of the run.
+ * @param from - the position to start scanning at.
+ * @param n - the number of elements in the run.
+ * @param width - the size of an element.
+ * @param elem - the element to search for.
+ * @return the position of the first match, or -1 if there is none.
  **/
-void* v_remf(vect_t* const v) {
-   return v_rem(v, 0);
+static int __v_scan_scalar(const char *base, int from, int n, size_t width,
+                           const void *elem) {
+   int i;
+
+   for(i = from; i < n; i++)
+      if(memcmp(elem, base + (size_t) i * width, width) == 0)
+         return i;
+
+   return -1;
 }
 
 
+#ifdef V_SIMD
+
 /**
- * Removes and returns the last element in the specified vector.
+ * Reduce a byte-equality mask to one bit per element. Bit i of the mask is
+ * set when byte i of a register matched; the result keeps the lowest bit of
+ * each element only if all of that element's bytes matched.
  *
- * @param v - the vector to retrieve the element from.
- * @return the last element in the vector. Returns NULL if the vector is empty
- *    or NULL.
+ * @param m - the byte-equality mask.
+ * @param width - the size of an element (1, 2, 4, 8 or 16).
+ * @return the mask with one bit set at the start of each matching element.
  **/
-void* v_reml(vect_t* const v) {
-   if(!v) return NULL;
-
-   return v_rem(v, v->__size - 1);
+static uint64_t __v_lanes(uint64_t m, size_t width) {
+   switch(width) {
+      case 16:
+         m &= m >> 8;
+         m &= m >> 4;
+         m &= m >> 2;
+         m &= m >> 1;
+         return m & 0x0001000100010001ULL;
+
+      case 8:
+         m &= m >> 4;
+         m &= m >> 2;
+         m &= m >> 1;
+         return m & 0x0101010101010101ULL;
+
+      case 4:
+         m &= m >> 2;
+         m &= m >> 1;
+         return m & 0x1111111111111111ULL;
+
+      case 2:
+         m &= m >> 1;
+         return m & 0x5555555555555555ULL;
+
+      default:
+         return m;
+   }
 }
 
 
 /**
- * Replaces the element at the specified index with the specified element.
+ * Fill a register-sized pattern with copies of an element.
  *
- * @param v - the vector in which to replace the specified element.
- * @param index - specified index of the element to replace.
- * @param elem - element to be stored at the specified index.
- * @return the element previously stored at the specified index.
+ * @param pat - the 64 byte pattern to fill.
+ * @param width - the size of an element; divides 64.
+ * @param elem - the element to repeat.
  **/
-void* v_set(vect_t* const v, int index, void* const elem) {
-   void *target;
+static void __v_pattern(char *pat, size_t width, const void *elem) {
+   size_t k;
 
-   if(!v) return NULL;
+   for(k = 0; k < 64; k += width)
+      memcpy(pat + k, elem, width);
+}
 
-   if(index < 0 || index >= v->__size)
-      return NULL;
 
-   target = v->__elements[index];
-   v->__elements[index] = elem;
+/**
+ * SSE2 version of __v_scan_scalar(...). Compares 16 bytes per step.
+ **/
+__attribute__((target("sse2")))
+static int __v_scan_sse2(const char *base, int from, int n, size_t width,
+                         const void *elem) {
+   char pat[64];
+   __m128i key, cur;
+   uint64_t m;
+   int i, per;
+
+   __v_pattern(pat, width, elem);
+   key = _mm_loadu_si128((const __m128i*) pat);
+   per = (int) (16 / width);
+
+   for(i = from; i + per <= n; i += per) {
+      cur = _mm_loadu_si128((const __m128i*) (base + (size_t) i * width));
+      m = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(cur, key));
+      m = __v_lanes(m, width);
+
+      if(m) return i + (int) (__builtin_ctzll(m) / width);
+   }
 
-   return target;
+   return __v_scan_scalar(base, i, n, width, elem);
 }
 
 
 /**
- * Creates and returns a pointer to an array representation of the vector.
- * Returns a pointer to an array on which free(...) may be called.
- *
- * @param v - the vector to translate to an array.
- * @return a pointer to an array representation of the vector.
+ * AVX2 version of __v_scan_scalar(...). Compares 32 bytes per step.
  **/
-void** v_toarr(vect_t* const v) {
-   int **array;
-   int size;
+__attribute__((target("avx2")))
+static int __v_scan_avx2(const char *base, int from, int n, size_t width,
+                         const void *elem) {
+   char pat[64];
+   __m256i key, cur;
+   uint64_t m;
+   int i, per;
+
+   __v_pattern(pat, width, elem);
+   key = _mm256_loadu_si256((const __m256i*) pat);
+   per = (int) (32 / width);
+
+   for(i = from; i + per <= n; i += per) {
+      cur = _mm256_loadu_si256((const __m256i*) (base + (size_t) i * width));
+      m = (unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(cur, key));
+      m = __v_lanes(m, width);
+
+      if(m) return i + (int) (__builtin_ctzll(m) / width);
+   }
 
-   if(!v) return NULL;
+   return __v_scan_scalar(base, i, n, width, elem);
+}
+
+
+/**
+ * AVX-512 version of __v_scan_scalar(...). Compares 64 bytes per step.
+ **/
+__attribute__((target("avx512f,avx512bw")))
+static int __v_scan_avx512(const char *base, int from, int n, size_t width,
+                           const void *elem) {
+   char pat[64];
+   __m512i key, cur;
+   uint64_t m;
+   int i, per;
+
+   __v_pattern(pat, width, elem);
+   key = _mm512_loadu_si512((const void*) pat);
+   per = (int) (64 / width);
+
+   for(i = from; i + per <= n; i += per) {
+      cur = _mm512_loadu_si512((const void*) (base + (size_t) i * width));
+      m = _mm512_cmpeq_epi8_mask(cur, key);
+      m = __v_lanes(m, width);
+
+      if(m) return i + (int) (__builtin_ctzll(m) / width);
+   }
+
+   return __v_scan_scalar(base, i, n, width, elem);
+}
+
+#endif   /* V_SIMD */
+
+
+/* The search kernel in use; NULL until picked */
+static int (*__v_kernel)(const char*, int, int, size_t, const void*) = NULL;
+
+
+/**
+ * Forces by-value searches to use a given kernel, so that the kernels can be
+ * checked against each other.
+ *
+ * NOTE: This is a function that is not intended for use by the user. It
+ * exists for testing.
+ *
+ * @param level - V_SCAN_SCALAR, V_SCAN_SSE2, V_SCAN_AVX2 or V_SCAN_AVX512;
+ *    V_SCAN_AUTO goes back to the widest kernel the processor supports.
+ * @return 1 if the kernel is now in use. Returns 0 if it was not built or
+ *    the processor does not support it.
+ **/
+int __v_scan_force(int level) {
+   __v_kernel = NULL;
+
+   if(level == V_SCAN_AUTO) return 1;
+
+   if(level == V_SCAN_SCALAR) {
+      __v_kernel = __v_scan_scalar;
+      return 1;
+   }
+
+#ifdef V_SIMD
+   __builtin_cpu_init();
+
+   if(level == V_SCAN_SSE2 && __builtin_cpu_supports("sse2"))
+      __v_kernel = __v_scan_sse2;
+   else if(level == V_SCAN_AVX2 && __builtin_cpu_supports("avx2"))
+      __v_kernel = __v_scan_avx2;
+   else if(level == V_SCAN_AVX512 && __builtin_cpu_supports("avx512bw"))
+      __v_kernel = __v_scan_avx512;
+#endif
+
+   return (__v_kernel != NULL);
+}
+
+
+/**
+ * Scan a run of contiguous elements with the widest kernel the processor
+ * supports. The kernel is picked once, on first use.
+ *
+ * @param base - the first element of the run.
+ * @param n - the number of elements in the run.
+ * @param width - the size of an element.
+ * @param elem - the element to search for.
+ * @return the position of the first match, or -1 if there is none.
+ **/
+static int __v_scan(const char *base, int n, size_t width, const void *elem) {
+#ifdef V_SIMD
+   /* Only power of two widths up to 16 bytes tile a register */
+   if(width > 16 || (width & (width - 1)))
+      return __v_scan_scalar(base, 0, n, width, elem);
+
+   if(!__v_kernel) {
+      __builtin_cpu_init();
+
+      if(__builtin_cpu_supports("avx512bw"))
+         __v_kernel = __v_scan_avx512;
+      else if(__builtin_cpu_supports("avx2"))
+         __v_kernel = __v_scan_avx2;
+      else if(__builtin_cpu_supports("sse2"))
+         __v_kernel = __v_scan_sse2;
+      else
+         __v_kernel = __v_scan_scalar;
+   }
+
+   return __v_kernel(base, 0, n, width, elem);
+#else
+   return __v_scan_scalar(base, 0, n, width, elem);
+#endif
+}
+
+
+/**
+ * Find the first element of a vector equal to the specified element.
+ * Sorted vectors are binary searched with their ordering. By-value vectors
+ * are scanned directly; otherwise each element pointer is followed in turn.
+ *
+ * @param v - the vector to search.
+ * @param elem - the element to search for.
+ * @return the index of the first match, or -1 if there is none.
+ **/
+static int __v_find(vect_t* const v, void* const elem) {
+   size_t num_bytes;
+   int i, size, found;
+
+   num_bytes = v->__elem_size;
+   size = v->__size;
+
+   /* Sorted vectors are binary searched */
+   if(v->__flags & V_SORTED) {
+      i = __v_bound(v, v->__cmp, elem, 0);
+
+      if(i < size && __v_compare(v, v->__cmp, elem, __v_elem(v, i)) == 0)
+         return i;
+
+      return -1;
+   }
+
+   /* Scan the slots up to the end of the buffer, then any wrapped slots */
+   if(v->__flags & V_INLINE) {
+      i = size;
+
+      if((v->__flags & V_RING) && v->__head + size > v->__cap)
+         i = v->__cap - v->__head;
+
+      found = __v_scan(__v_slot(v, 0), i, num_bytes, elem);
+
+      if(found < 0 && i < size) {
+         found = __v_scan(v->__data, size - i, num_bytes, elem);
+
+         if(found >= 0) found += i;
+      }
+
+      return found;
+   }
+
+   /* Look for first occurance */
+   for(i = 0; i < size; i++)
+      if(memcmp(elem, __v_elem(v, i), num_bytes) == 0)
+         return i;
+
+   /* Element not found */
+   return -1;
+}
+
+
+/**
+ * Adds the specified element at the specified index in the vector. Shifts
+ * remaining elements right one position (incrementing indices). Ring vectors
+ * shift the elements before the index instead when there are fewer of them.
+ * Sorted vectors ignore the index and add the element in order.
+ *
+ * @param v - the vector to add the specified element to.
+ * @param index - the index to insert the specified element.
+ * @param elem - the specified element to add to the vector.
+ * @return 1 if the element is added to the vector. Return 0 if the vector is
+ *    NULL, or if the specified index is less than zero (0) or larger than the
+ *    size of the vector.
+ **/
+int v_add(vect_t* const v, int index, void* const elem) {
+   size_t slot_size;
+   char *slot;
+
+   if(!v) return !ADDED;
+
+   /* Sorted vectors place the element after any equal to it */
+   if(v->__flags & V_SORTED) {
+      if(!elem) return !ADDED;
+
+      index = __v_bound(v, v->__cmp, elem, 1);
+   }
+
+   if(index < 0 || index > v->__size)
+      return !ADDED;
+
+   /* By-value vectors need something to copy from */
+   if((v->__flags & V_INLINE) && !elem)
+      return !ADDED;
+
+   if(v->__size == v->__cap && !__v_expand(v))
+      return !ADDED;
+
+   slot_size = v->__slot_size;
+
+   /* Ring vectors move whichever side of the index is shorter */
+   if((v->__flags & V_RING) && index < v->__size / 2) {
+      v->__head = (v->__head - 1) & (v->__cap - 1);
+      __v_move(v, 0, 1, index);
+   }
+
+   /* Move elements right one position */
+   else
+      __v_move(v, index + 1, index, v->__size - index);
+
+   slot = __v_slot(v, index);
+
+   if(v->__flags & V_INLINE)
+      memcpy(slot, elem, slot_size);
+   else
+      *(void**) slot = elem;
+
+   v->__size++;
+   return ADDED;
+}
+
+
+/**
+ * Add a specified element to the front of this vector.
+ *
+ * @param v - the vector to add the specified element to.
+ * @param elem - the element to add to the vector.
+ **/
+void v_addf(vect_t* const v, void* const elem) {
+   v_add(v, 0, elem);
+}
+
+
+/**
+ * Add a specified element to the end of this vector.
+ *
+ * @param v - the vector to add the specified element to.
+ * @param elem - the element to add to the vector.
+ **/
+void v_addl(vect_t* const v, void* const elem) {
+   if(!v) return;
+
+   v_add(v, v->__size, elem);
+}
+
+
+/**
+ * Adds a run of elements at the specified index in the vector. Shifts
+ * remaining elements right n positions (incrementing indices). The vector is
+ * grown at most once and the elements are moved and copied in bulk.
+ *
+ * @param v - the vector to add the elements to.
+ * @param index - the index to insert the first element at.
+ * @param elems - the elements to add. For by-value vectors, an array of n
+ *    elements; otherwise an array of n element pointers.
+ * @param n - the number of elements to add.
+ * @return 1 if the elements are added to the vector. Sorted vectors ignore
+ *    the index and add the elements in order. Return 0 if the vector
+ *    or the elements are NULL, if n is negative, if the specified index is
+ *    less than zero (0) or larger than the size of the vector, if a sorted
+ *    vector of pointers is given a NULL element, or upon allocation error;
+ *    no element is added then.
+ **/
+int v_addall(vect_t* const v, int index, void* const elems, int n) {
+   int cap, i, sorted;
+
+   if(!v || !elems || n < 0) return !ADDED;
+
+   if(!(v->__flags & V_SORTED) && (index < 0 || index > v->__size))
+      return !ADDED;
+
+   /* Sorted vectors compare every element, so none may be missing */
+   if((v->__flags & V_SORTED) && !(v->__flags & V_INLINE))
+      for(i = 0; i < n; i++)
+         if(!((void**) elems)[i]) return !ADDED;
+
+   /* Grow once; keep the usual growth rate for small runs */
+   if(v->__size + n > v->__cap) {
+      cap = (v->__cap << 1) + 1;
+
+      if(cap < v->__size + n)
+         cap = v->__size + n;
+
+      if(!__v_resize(v, cap))
+         return !ADDED;
+   }
+
+   /**
+    * Sorted vectors; append long runs and sort. If the sort cannot allocate,
+    * take the run back off and insert it like a short run, one element at a
+    * time. Nothing after the growth above can fail, so either every element
+    * is added or none is.
+    **/
+   if(v->__flags & V_SORTED) {
+      if(n >= SORT_CUTOFF) {
+         v->__flags &= ~V_SORTED;
+         __v_copyin(v, v->__size, elems, n);
+         v->__size += n;
+
+         sorted = v_sort(v, v->__cmp);
+         v->__flags |= V_SORTED;
+
+         if(sorted) return ADDED;
+
+         v->__size -= n;
+      }
+
+      for(i = 0; i < n; i++)
+         v_add(v, 0, (v->__flags & V_INLINE ?
+                      (char*) elems + (size_t) i * v->__slot_size :
+                      ((void**) elems)[i]));
+
+      return ADDED;
+   }
+
+   /* Make room on whichever side of the index is shorter */
+   if((v->__flags & V_RING) && index < v->__size / 2) {
+      v->__head = (v->__head - n) & (v->__cap - 1);
+      __v_move(v, 0, n, index);
+   }
+   else
+      __v_move(v, index + n, index, v->__size - index);
+
+   __v_copyin(v, index, elems, n);
+
+   v->__size += n;
+   return ADDED;
+}
+
+
+/**
+ * Attempts to remove all elements in the specified vector. Applies free(...)
+ * to each element in a vector and sets the size of the vector to 0. Elements
+ * of a by-value vector are owned by the vector and are simply discarded.
+ *
+ * @param v - the vector to clear.
+ **/
+void v_clear(vect_t* const v) {
+   v_apply(v, free);
+}
+
+
+/**
+ * Determines if the specified element is contained within this vector.
+ *
+ * @param v - the vector possibly containing the specified element.
+ * @param elem - the element possibly contained within the specified vector.
+ * @return 1 if the element exists in the specified vector. Returns 0 otherwise
+ *    or if the list is NULL;
+ **/
+int v_contains(vect_t* const v, void* const elem) {
+   if(!v || !elem) return !EXIST;
+
+   return (__v_find(v, elem) >= 0 ? EXIST : !EXIST);
+}
+
+
+/**
+ * Retrieves (but does not remove) the element at the specified index in
+ * the vector.
+ *
+ * @param v - the vector to retrieve the element from.
+ * @param index - the index in the specified vector to retrieve.
+ * @return the element at the specified index. Returns 0 if the vector is NULL,
+ *    if the index is less than zero (0), or if the index is greater than the
+ *    size of the vector.
+ **/
+void* v_get(vect_t* const v, int index) {
+   if(!v) return NULL;
+
+   if(index < 0 || index >= v->__size)
+      return NULL;
+
+   return __v_elem(v, index);
+}
+
+
+/**
+ * Retrieves (but does not remove) the first element in the specified vector.
+ *
+ * @param v - the vector to retrieve the element from.
+ * @return the first element in the vector. Returns NULL if the vector is NULL
+ *    or empty.
+ **/
+void* v_first(vect_t* const v) {
+   return v_get(v, 0);
+}
+
+
+/**
+ * Retrieves (but does not remove) the last element in the specified vector.
+ *
+ * @param v - the vector to retrieve the element from.
+ * @return the last element in the vector. Returns NULL if the vector is NULL
+ *    or empty.
+ **/
+void* v_last(vect_t* const v) {
+   if(!v) return NULL;
+
+   return v_get(v, v->__size - 1);
+}
+
+
+/**
+ * Retrieve the index of the first occurrence of the specifed element in
+ * the specified vector.
+ *
+ * @param v - the vector to retreive the index from.
+ * @param elem - the element to search for.
+ * @return the index of the first occurrence of the specified element, or -1 if
+ *    the vector is NULL or does not contain the specified element.
+ **/
+int v_indexof(vect_t* const v, void* const elem) {
+   if(!v || !elem) return -1;
+
+   return __v_find(v, elem);
+}
+
+
+/**
+ * Apply a function over all the elements in a vector.
+ *
+ * @param v - the vector to apply an operation over.
+ * @param funct - the function to apply over the specified vector, where the
+ *    argument to the function is an element in the vector.
+ **/
+void v_apply(vect_t* const v, void (*funct)(void* const)) {
+   int i, size;
+
+   if(!v) return;
+
+   size = v->__size;
+
+   /* By-value elements are owned by the vector; nothing to free */
+   if(funct == free && (v->__flags & V_INLINE)) {
+      v->__size = 0;
+      return;
+   }
+
+   /* For each element in the list */
+   for(i = 0; i < size; i++)
+      (funct)(__v_elem(v, i));
+
+   if(funct == free)
+      v->__size = 0;
+}
+
+
+/**
+ * Removes the element at the specified index in the specified vector. Shifts
+ * remaining elements left one position (decrementing indices). For by-value
+ * vectors, the removed element is copied aside and the returned pointer is
+ * valid until the next removal or replacement.
+ *
+ * @param v - the vector to remove the specified element from.
+ * @param index - the index of the element to be removed.
+ * @return 1 if the vector contained the specified element. Returns 0 if the
+ *    vector is NULL or the index is less than zero (0) or the index is greater
+ *    than the size of the vector.
+ **/
+void* v_rem(vect_t* const v, int index) {
+   void *target;
+   char *slot;
+
+   if(!v) return NULL;
+
+   if(index < 0 || index >= v->__size)
+      return NULL;
+
+   slot = __v_slot(v, index);
+
+   /* Save the element before it is overwritten */
+   if(v->__flags & V_INLINE)
+      target = memcpy(v->__spare, slot, v->__slot_size);
+   else
+      target = *(void**) slot;
+
+   /* Ring vectors close the gap from whichever side is shorter */
+   if((v->__flags & V_RING) && index < v->__size / 2) {
+      __v_move(v, 1, 0, index);
+      v->__head = (v->__head + 1) & (v->__cap - 1);
+   }
+
+   /* Shift elements left one position */
+   else
+      __v_move(v, index, index + 1, v->__size - index - 1);
+
+   v->__size--;
+   return target;
+}
+
+
+/**
+ * Removes and returns the first element in the specified vector.
+ *
+ * @param v - the vector to retrieve the element from.
+ * @return the first element in the vector. Returns NULL if the list is empty
+ *    or NULL.
+ **/
+void* v_remf(vect_t* const v) {
+   return v_rem(v, 0);
+}
+
+
+/**
+ * Removes and returns the last element in the specified vector.
+ *
+ * @param v - the vector to retrieve the element from.
+ * @return the last element in the vector. Returns NULL if the vector is empty
+ *    or NULL.
+ **/
+void* v_reml(vect_t* const v) {
+   if(!v) return NULL;
+
+   return v_rem(v, v->__size - 1);
+}
+
+
+/**
+ * Removes the elements in the range [from, to) of the specified vector.
+ * Shifts remaining elements left (to - from) positions with a single move.
+ *
+ * @param v - the vector to remove the elements from.
+ * @param from - the index of the first element to remove.
+ * @param to - one past the index of the last element to remove.
+ * @param funct - a function applied to each removed element before it is
+ *    removed, such as free(...); may be NULL. Elements of a by-value vector
+ *    are owned by the vector and are never passed to free(...).
+ * @return the number of elements removed. Returns 0 if the vector is NULL or
+ *    the range is not within the vector.
+ **/
+int v_rem_range(vect_t* const v, int from, int to,
+                void (*funct)(void* const)) {
+   int i;
+
+   if(!v) return 0;
+
+   if(from < 0 || to > v->__size || from >= to)
+      return 0;
+
+   if(funct && !(funct == free && (v->__flags & V_INLINE)))
+      for(i = from; i < to; i++)
+         (funct)(__v_elem(v, i));
+
+   /* Ring vectors close the gap from whichever side is shorter */
+   if((v->__flags & V_RING) && from < v->__size - to) {
+      __v_move(v, to - from, 0, from);
+      v->__head = (v->__head + to - from) & (v->__cap - 1);
+   }
+
+   /* Shift the tail left over the removed range */
+   else
+      __v_move(v, from, to, v->__size - to);
+
+   v->__size -= to - from;
+   return to - from;
+}
+
+
+/**
+ * Removes every element of the specified vector for which a predicate holds,
+ * in a single pass. Remaining elements keep their order.
+ *
+ * @param v - the vector to remove elements from.
+ * @param pred - the predicate; called with an element and ctx, returns
+ *    nonzero if the element is to be removed.
+ * @param ctx - an argument passed through to the predicate; may be NULL.
+ * @param funct - a function applied to each removed element, such as
+ *    free(...); may be NULL. Elements of a by-value vector are owned by the
+ *    vector and are never passed to free(...).
+ * @return the number of elements removed. Returns 0 if the vector or the
+ *    predicate is NULL.
+ **/
+int v_remove_if(vect_t* const v, int (*pred)(void* const, void*), void* ctx,
+                void (*funct)(void* const)) {
+   return __v_filter(v, pred, ctx, funct, 0);
+}
+
+
+/**
+ * Removes every element of the specified vector for which a predicate does
+ * not hold, in a single pass. The opposite of v_remove_if(...).
+ *
+ * @param v - the vector to remove elements from.
+ * @param pred - the predicate; called with an element and ctx, returns
+ *    nonzero if the element is to be kept.
+ * @param ctx - an argument passed through to the predicate; may be NULL.
+ * @param funct - a function applied to each removed element; may be NULL.
+ * @return the number of elements removed. Returns 0 if the vector or the
+ *    predicate is NULL.
+ **/
+int v_retain(vect_t* const v, int (*pred)(void* const, void*), void* ctx,
+             void (*funct)(void* const)) {
+   return __v_filter(v, pred, ctx, funct, 1);
+}
+
+
+/**
+ * Compact a vector over the elements for which a predicate gives the
+ * specified answer, sliding each kept slot down over the removed ones.
+ *
+ * @param keep - nonzero to keep elements the predicate holds for, zero (0)
+ *    to remove them.
+ * @return the number of elements removed.
+ **/
+static int __v_filter(vect_t* const v, int (*pred)(void* const, void*),
+                      void* ctx, void (*funct)(void* const), int keep) {
+   void *elem;
+   int i, kept, size;
+
+   if(!v || !pred) return 0;
+
+   if(funct == free && (v->__flags & V_INLINE))
+      funct = NULL;
+
+   size = v->__size;
+
+   for(i = kept = 0; i < size; i++) {
+      elem = __v_elem(v, i);
+
+      /* Removed; the slot will be written over */
+      if(!pred(elem, ctx) != !keep) {
+         if(funct) (funct)(elem);
+         continue;
+      }
+
+      if(kept != i)
+         memcpy(__v_slot(v, kept), __v_slot(v, i), v->__slot_size);
+
+      kept++;
+   }
+
+   v->__size = kept;
+   return size - kept;
+}
+
+
+/**
+ * Replaces the element at the specified index with the specified element. For
+ * by-value vectors, the element is copied in and the former element is copied
+ * aside as it is by v_rem(...).
+ *
+ * @param v - the vector in which to replace the specified element.
+ * @param index - specified index of the element to replace.
+ * @param elem - element to be stored at the specified index.
+ * @return the element previously stored at the specified index. Returns NULL
+ *    if the vector is NULL, the index is out of range, or the vector is kept
+ *    sorted.
+ **/
+void* v_set(vect_t* const v, int index, void* const elem) {
+   void *target;
+   char *slot;
+
+   if(!v) return NULL;
+
+   if(index < 0 || index >= v->__size)
+      return NULL;
+
+   /* Replacing could break the order */
+   if(v->__flags & V_SORTED)
+      return NULL;
+
+   slot = __v_slot(v, index);
+
+   /* By-value vectors copy the element in */
+   if(v->__flags & V_INLINE) {
+      if(!elem) return NULL;
+
+      target = memcpy(v->__spare, slot, v->__slot_size);
+      memcpy(slot, elem, v->__slot_size);
+
+      return target;
+   }
+
+   target = *(void**) slot;
+   *(void**) slot = elem;
+
+   return target;
+}
+
+
+/**
+ * Creates and returns a pointer to an array representation of the vector.
+ * Returns a pointer to an array on which free(...) may be called. For by-value
+ * vectors, the array holds pointers into the vector's storage.
+ *
+ * @param v - the vector to translate to an array.
+ * @return a pointer to an array representation of the vector.
+ **/
+void** v_toarr(vect_t* const v) {
+   void **array;
+   int i, size;
+
+   if(!v) return NULL;
+
+   size = v->__size;
+
+   array = malloc(sizeof(void*) * (size ? size : 1));
+
+   if(!array) return NULL;
+
+   /* Assign pointers to new array */
+   for(i = 0; i < size; i++)
+      array[i] = __v_elem(v, i);
+
+   return array;
+}
+
+
+/**
+ * Trim the capacity of the vector to the current size of the vector.
+ *
+ * @param v - the vector to trim to size.
+ * @return the vector trimmed to its size. Returns NULL if the vector is NULL.
+ **/
+void v_trim(vect_t* const v) {
+   if(!v) return;
+
+   /* Keeps the old buffer if it could not be shrunk */
+   __v_resize(v, v->__size);
+}
+
+
+/** Vector Iterator Functions **/
+
+/**
+ * A simulated constructor for a vector iterator. Returns an iterator over
+ * a specified vector starting at a specified index.
+ *
+ * @param v - the vector to return an iterator over.
+ * @param index - the position that the iterator will start at.
+ * @return an iterator over the specified vector. Returns a NULL pointer if the
+ *    specified vector is NULL, (index < 0 || index >= v_size(v)), or upon
+ *    allocation error.
+ **/
+v_itr_t* v_itr(vect_t* const v, int index) {
+   v_itr_t *iterator;
+
+   if(!v) return NULL;
+
+   if(index < 0 || index >= v->__size)
+      return NULL;
+
+   iterator = malloc(sizeof(v_itr_t));
+
+   if(!iterator) return NULL;
+
+   iterator->vector = v;
+   iterator->pos = index;
+
+   /* Index not found */
+   return iterator;
+}
+
+
+/**
+ * A simulated destructor for a vector iterator.
+ *
+ * @param itr - the iterator to destroy.
+ **/
+void vi_free(v_itr_t* const itr) {
+   free(itr);
+}
+
+
+/**
+ * Indicates whether or not the iterator has more elements. In other words,
+ * returns 1 if vi_next(...) would return an element.
+ *
+ * @param itr - the iterator to check against for more elements.
+ * @return 1 if there exists more elements in the iterator. Returns 0 if the
+ *    iterator is NULL or does not have anymore elements.
+ **/
+int vi_hasnext(v_itr_t* const itr) {
+   if(!itr) return !EXIST;
+
+   /* There exists another element */
+   if(itr->pos == itr->vector->__size)
+      return !EXIST;
+
+   return EXIST;
+}
+
+
+/**
+ * Indicates whether or not the iterator has previous elements. In other words,
+ * returns 1 if vi_prev(...) would return an element.
+ *
+ * @param itr - the iterator to check against for previous elements.
+ * @return 1 if there exists a previous element in the iterator. Returns 0 if
+ *    the iterator is NULL of does not have any previous elements.
+ **/
+int vi_hasprev(v_itr_t* const itr) {
+   if(!itr) return !EXIST;
+
+   /* There exists a previous element */
+   return (itr->pos ? EXIST : !EXIST);
+}
+
+
+/**
+ * Retrieves (but does not remove) the next element in the iterator.
+ *
+ * @param itr - the iterator to return an element from.
+ * @return the next element in the iterator. Returns NULL if the iterator is
+ *    NULL or there are no more elements in the iterator.
+ **/
+void* vi_next(v_itr_t* const itr) {
+   void *target;
+
+   if(!itr) return NULL;
+
+   /* If there are more elements */
+   if(!vi_hasnext(itr)) return NULL;
+
+   target = __v_elem(itr->vector, itr->pos);
+   itr->pos++;
+
+   return target;
+}
+
+
+/**
+ * Retrieves (but does not remove) the previous element in the iterator.
+ *
+ * @param itr - the iterator to return an element from.
+ * @return the previous element in the iterator. Returns NULL if the iterator
+ *    is NULL or there are no previous elements in the iterator.
+ **/
+void* vi_prev(v_itr_t* const itr) {
+   void *target;
+
+   if(!itr) return NULL;
+
+   /* If there are more elements */
+   if(!vi_hasprev(itr)) return NULL;
+
+   target = __v_elem(itr->vector, itr->pos);
+   itr->pos--;
+
+   return target;
+}
+
+
+
+/** Vector Cursor Functions **/
+
+/**
+ * Position a caller-owned cursor over a specified vector at a specified
+ * index. The cursor is stepped with vc_next(...) and vc_prev(...), which are
+ * macros and never allocate.
+ *
+ * @param v - the vector to walk.
+ * @param cur - the cursor to position.
+ * @param index - the position of the element the first vc_next(...) returns;
+ *    may be the size of the vector.
+ * @return 1 if the cursor was positioned. Returns 0 if either pointer is NULL
+ *    or (index < 0 || index > v_size(v)).
+ **/
+int v_cur(vect_t* const v, v_cur_t* const cur, int index) {
+   if(!v || !cur) return !EXIST;
+
+   if(index < 0 || index > v->__size)
+      return !EXIST;
+
+   cur->__base = v->__data;
+   cur->__stride = v->__slot_size;
+   cur->__head = v->__head;
+   cur->__mask = (v->__flags & V_RING ? v->__cap - 1 : -1);
+   cur->__pos = index;
+   cur->__end = v->__size;
+   cur->__byval = (v->__flags & V_INLINE ? 1 : 0);
+
+   return EXIST;
+}
+
+
+/** Vector Ordering Functions **/
+
+/**
+ * Compare two integers of the same width.
+ *
+ * @param a - the first integer.
+ * @param b - the second integer.
+ * @param width - the size of the integers (1, 2, 4 or 8).
+ * @param is_signed - nonzero if the integers are signed.
+ * @return less than, equal to, or greater than zero (0) as a is less than,
+ *    equal to, or greater than b.
+ **/
+static int __v_intcmp(const void *a, const void *b, size_t width,
+                      int is_signed) {
+   int64_t sa, sb;
+   uint64_t ua, ub;
+
+   switch(width) {
+      case 1:
+         if(is_signed) {
+            sa = *(const signed char*) a;
+            sb = *(const signed char*) b;
+            break;
+         }
+
+         ua = *(const unsigned char*) a;
+         ub = *(const unsigned char*) b;
+         return (ua > ub) - (ua < ub);
+
+      case 2:
+         if(is_signed) {
+            int16_t x, y;
+            memcpy(&x, a, 2);
+            memcpy(&y, b, 2);
+            sa = x;
+            sb = y;
+            break;
+         }
+         else {
+            uint16_t x, y;
+            memcpy(&x, a, 2);
+            memcpy(&y, b, 2);
+            return (x > y) - (x < y);
+         }
+
+      case 4:
+         if(is_signed) {
+            int32_t x, y;
+            memcpy(&x, a, 4);
+            memcpy(&y, b, 4);
+            sa = x;
+            sb = y;
+            break;
+         }
+         else {
+            uint32_t x, y;
+            memcpy(&x, a, 4);
+            memcpy(&y, b, 4);
+            return (x > y) - (x < y);
+         }
+
+      case 8:
+         if(is_signed) {
+            memcpy(&sa, a, 8);
+            memcpy(&sb, b, 8);
+            break;
+         }
+
+         memcpy(&ua, a, 8);
+         memcpy(&ub, b, 8);
+         return (ua > ub) - (ua < ub);
+
+      /* Not an integer width; order by bytes */
+      default:
+         return memcmp(a, b, width);
+   }
 
-   size = v->__size;
+   return (sa > sb) - (sa < sb);
+}
 
-   array = malloc(sizeof(void*) * size);
 
-   if(!array) return NULL;
+/**
+ * Compare two elements with an ordering, which may be one of the built-in
+ * orderings V_CMP_MEM, V_CMP_INT or V_CMP_UINT.
+ *
+ * @param cmp - the ordering to compare with.
+ * @param width - the size of an element.
+ * @param a - the first element.
+ * @param b - the second element.
+ * @return less than, equal to, or greater than zero (0) as a is ordered
+ *    before, with, or after b.
+ **/
+static int __v_order(int (*cmp)(const void*, const void*), size_t width,
+                     const void *a, const void *b) {
+   if(cmp == V_CMP_MEM)
+      return memcmp(a, b, width);
 
-   /* Assign pointers to new array */
-   array = memcpy(array, v->__elements, sizeof(void*) * size);
+   if(cmp == V_CMP_INT || cmp == V_CMP_UINT)
+      return __v_intcmp(a, b, width, cmp == V_CMP_INT);
 
-   return (void**) array;
+   return (cmp)(a, b);
 }
 
 
 /**
- * Trim the capacity of the vector to the current size of the vector.
+ * Compare two elements of a vector with an ordering.
+ **/
+static int __v_compare(vect_t* const v,
+                       int (*cmp)(const void*, const void*),
+                       const void *a, const void *b) {
+   return __v_order(cmp, v->__elem_size, a, b);
+}
+
+
+/**
+ * Find the first position in a sorted vector whose element is not ordered
+ * before (or, for an upper bound, is ordered after) the specified element.
+ * The search halves the range without branching on the comparison.
  *
- * @param v - the vector to trim to size.
- * @return the vector trimmed to its size. Returns NULL if the vector is NULL.
+ * @param v - the sorted vector to search.
+ * @param cmp - the ordering the vector is sorted by.
+ * @param elem - the element to search for.
+ * @param upper - nonzero to skip past elements equal to elem.
+ * @return the position found, between zero (0) and the size of the vector.
  **/
-void v_trim(vect_t* const v) {
-   int size;
+static int __v_bound(vect_t* const v, int (*cmp)(const void*, const void*),
+                     const void *elem, int upper) {
+   int base, n, half;
 
-   if(!v) return;
+   n = v->__size;
+   base = 0;
 
-   size = v->__size;
-   v->__elements = realloc(v->__elements, sizeof(void*) * size);
-   v->__cap = size;
+   if(!n) return 0;
+
+   while(n > 1) {
+      half = n >> 1;
+      base += (__v_compare(v, cmp, __v_elem(v, base + half), elem) < upper) *
+              half;
+      n -= half;
+   }
+
+   return base + (__v_compare(v, cmp, __v_elem(v, base), elem) < upper);
 }
 
 
-/** Vector Iterator Functions **/
+/**
+ * Determine if one slot is ordered before another.
+ **/
+static int __v_less(const __v_ord_t *o, const char *a, const char *b) {
+   if(!o->byval) {
+      a = *(char* const*) a;
+      b = *(char* const*) b;
+   }
+
+   return __v_order(o->cmp, o->elem_size, a, b) < 0;
+}
+
 
 /**
- * A simulated constructor for a vector iterator. Returns an iterator over
- * a specified vector starting at a specified index.
+ * Exchange the contents of two slots.
+ **/
+static void __v_swap(const __v_ord_t *o, char *a, char *b) {
+   size_t k;
+   char t;
+   void *p;
+
+   if(o->slot_size == sizeof(void*)) {
+      memcpy(&p, a, sizeof(void*));
+      memcpy(a, b, sizeof(void*));
+      memcpy(b, &p, sizeof(void*));
+      return;
+   }
+
+   for(k = 0; k < o->slot_size; k++) {
+      t = a[k];
+      a[k] = b[k];
+      b[k] = t;
+   }
+}
+
+
+/**
+ * Sort a short run of slots by insertion.
+ **/
+static void __v_insertion(const __v_ord_t *o, char *base, int n) {
+   size_t ss;
+   int i, j;
+
+   ss = o->slot_size;
+
+   for(i = 1; i < n; i++)
+      for(j = i; j > 0 && __v_less(o, base + j * ss, base + (j - 1) * ss); j--)
+         __v_swap(o, base + j * ss, base + (j - 1) * ss);
+}
+
+
+/**
+ * Sift a slot down a heap of slots until neither child is ordered after it.
+ **/
+static void __v_sift(const __v_ord_t *o, char *base, int root, int n) {
+   size_t ss;
+   int child;
+
+   ss = o->slot_size;
+
+   while((child = 2 * root + 1) < n) {
+      if(child + 1 < n && __v_less(o, base + child * ss, base + (child + 1) * ss))
+         child++;
+
+      if(!__v_less(o, base + root * ss, base + child * ss))
+         return;
+
+      __v_swap(o, base + root * ss, base + child * ss);
+      root = child;
+   }
+}
+
+
+/**
+ * Sort a run of slots with heapsort. Used when quicksort recurses too deeply.
+ **/
+static void __v_heapsort(const __v_ord_t *o, char *base, int n) {
+   int i;
+
+   for(i = n / 2 - 1; i >= 0; i--)
+      __v_sift(o, base, i, n);
+
+   /* Repeatedly move the largest slot to the end */
+   for(i = n - 1; i > 0; i--) {
+      __v_swap(o, base, base + i * o->slot_size);
+      __v_sift(o, base, 0, i);
+   }
+}
+
+
+/**
+ * Partition a run of slots around the median of its first, middle and last
+ * slots.
  *
- * @param v - the vector to return an iterator over.
- * @param index - the position that the iterator will start at.
- * @return an iterator over the specified vector. Returns a NULL pointer if the
- *    specified vector is NULL, (index < 0 || index >= v_size(v)), or upon
+ * @return the number of slots in the left part; between 1 and n - 1.
+ **/
+static int __v_partition(const __v_ord_t *o, char *base, int n) {
+   size_t ss;
+   char *lo, *mid, *hi;
+   int i, j;
+
+   ss = o->slot_size;
+   lo = base;
+   mid = base + (n / 2) * ss;
+   hi = base + (n - 1) * ss;
+
+   /* Order the three candidates */
+   if(__v_less(o, mid, lo)) __v_swap(o, mid, lo);
+   if(__v_less(o, hi, mid)) __v_swap(o, hi, mid);
+   if(__v_less(o, mid, lo)) __v_swap(o, mid, lo);
+
+   memcpy(o->pivot, mid, ss);
+
+   i = -1;
+   j = n;
+
+   for(;;) {
+      do i++; while(__v_less(o, base + i * ss, o->pivot));
+      do j--; while(__v_less(o, o->pivot, base + j * ss));
+
+      if(i >= j) return j + 1;
+
+      __v_swap(o, base + i * ss, base + j * ss);
+   }
+}
+
+
+/**
+ * Sort a run of slots with introsort: quicksort that falls back to heapsort
+ * after depth partitions, finishing short runs by insertion.
+ **/
+static void __v_introsort(const __v_ord_t *o, char *base, int n, int depth) {
+   int p;
+
+   while(n > SORT_CUTOFF) {
+      if(depth-- == 0) {
+         __v_heapsort(o, base, n);
+         return;
+      }
+
+      p = __v_partition(o, base, n);
+
+      /* Recurse into the smaller part, loop on the larger */
+      if(p < n - p) {
+         __v_introsort(o, base, p, depth);
+         base += p * o->slot_size;
+         n -= p;
+      }
+      else {
+         __v_introsort(o, base + p * o->slot_size, n - p, depth);
+         n = p;
+      }
+   }
+
+   __v_insertion(o, base, n);
+}
+
+
+/**
+ * Retrieve the integer key of a slot as an unsigned number whose byte order
+ * matches the ordering; the sign bit of signed keys is flipped.
+ **/
+static uint64_t __v_key(const __v_ord_t *o, const char *slot, int is_signed) {
+   uint32_t k32;
+   uint64_t k;
+
+   if(!o->byval)
+      slot = *(char* const*) slot;
+
+   if(o->elem_size == 4) {
+      memcpy(&k32, slot, 4);
+      k = k32;
+
+      return (is_signed ? k ^ 0x80000000UL : k);
+   }
+
+   memcpy(&k, slot, 8);
+
+   return (is_signed ? k ^ ((uint64_t) 1 << 63) : k);
+}
+
+
+/**
+ * Sort a run of slots holding 4 or 8 byte integers with a least significant
+ * digit radix sort, one byte per pass. Passes in which every key has the
+ * same digit are skipped.
+ *
+ * @return 1 if the run was sorted. Returns 0 upon allocation error.
+ **/
+static int __v_radix(const __v_ord_t *o, char *base, int n, int is_signed) {
+   size_t ss, count[8][256], pos, c;
+   char *src, *dst, *tmp;
+   uint64_t k;
+   int i, d, width;
+
+   ss = o->slot_size;
+   width = (int) o->elem_size;
+   tmp = malloc((size_t) n * ss);
+
+   if(!tmp) return !ADDED;
+
+   memset(count, 0, sizeof(count));
+
+   /* Count every digit in one pass */
+   for(i = 0; i < n; i++) {
+      k = __v_key(o, base + i * ss, is_signed);
+
+      for(d = 0; d < width; d++)
+         count[d][(k >> (8 * d)) & 0xFF]++;
+   }
+
+   src = base;
+   dst = tmp;
+
+   for(d = 0; d < width; d++) {
+      /* All keys share this digit */
+      if(count[d][(__v_key(o, src, is_signed) >> (8 * d)) & 0xFF] == (size_t) n)
+         continue;
+
+      for(pos = 0, i = 0; i < 256; i++) {
+         c = count[d][i];
+         count[d][i] = pos;
+         pos += c;
+      }
+
+      for(i = 0; i < n; i++) {
+         k = __v_key(o, src + i * ss, is_signed);
+         memcpy(dst + count[d][(k >> (8 * d)) & 0xFF]++ * ss, src + i * ss, ss);
+      }
+
+      tmp = src;
+      src = dst;
+      dst = tmp;
+   }
+
+   if(src != base)
+      memcpy(base, src, (size_t) n * ss);
+
+   free(src == base ? dst : src);
+   return ADDED;
+}
+
+
+/**
+ * Sorts the elements of a vector. Integer keys of 4 or 8 bytes ordered by
+ * V_CMP_INT or V_CMP_UINT are radix sorted; everything else is sorted with
+ * introsort, which is not stable.
+ *
+ * @param v - the vector to sort.
+ * @param cmp - the ordering to sort by. Either a function returning less
+ *    than, equal to, or greater than zero (0) as its first element is ordered
+ *    before, with, or after its second, or one of the built-in orderings:
+ *    V_CMP_MEM (by bytes, as memcmp(...)), V_CMP_INT (as signed integers) or
+ *    V_CMP_UINT (as unsigned integers).
+ * @return 1 if the vector was sorted. Returns 0 if the vector is NULL or upon
  *    allocation error.
  **/
-v_itr_t* v_itr(vect_t* const v, int index) {
-   v_itr_t *iterator;
+int v_sort(vect_t* const v, int (*cmp)(const void*, const void*)) {
+   __v_ord_t ord;
+   char *data;
+   int depth, n, sorted;
 
-   if(!v) return NULL;
+   if(!v) return !ADDED;
 
-   if(index < 0 || index >= v->__size)
-      return NULL;
+   if(!__v_linearize(v)) return !ADDED;
 
-   iterator = malloc(sizeof(v_itr_t));
+   ord.cmp = cmp;
+   ord.elem_size = v->__elem_size;
+   ord.slot_size = v->__slot_size;
+   ord.byval = (v->__flags & V_INLINE ? 1 : 0);
+   ord.pivot = NULL;
 
-   if(!iterator) return NULL;
+   data = v->__data;
+   n = v->__size;
+   sorted = !ADDED;
 
-   iterator->vector = v;
-   iterator->pos = index;
+   /* Integer keys; sort by digits */
+   if((cmp == V_CMP_INT || cmp == V_CMP_UINT) && n >= RADIX_CUTOFF &&
+         (ord.elem_size == 4 || ord.elem_size == 8))
+      sorted = __v_radix(&ord, data, n, cmp == V_CMP_INT);
 
-   /* Index not found */
-   return iterator;
+   if(!sorted) {
+      ord.pivot = malloc(ord.slot_size);
+
+      if(!ord.pivot) return !ADDED;
+
+      for(depth = 0; (1 << depth) < n; depth++)
+         ;
+
+      __v_introsort(&ord, data, n, 2 * depth);
+      free(ord.pivot);
+   }
+
+   /* A sorted vector now follows this ordering */
+   if(v->__flags & V_SORTED)
+      v->__cmp = cmp;
+
+   return ADDED;
 }
 
 
 /**
- * A simulated destructor for a vector iterator.
+ * Searches a sorted vector for the specified element.
  *
- * @param itr - the iterator to destroy.
+ * @param v - the vector to search; must be sorted by cmp.
+ * @param elem - the element to search for.
+ * @param cmp - the ordering the vector is sorted by; see v_sort(...).
+ * @return the index of the first element equal to elem. Otherwise, returns
+ *    (-(insertion point) - 1), where the insertion point is the index at
+ *    which elem would be added to keep the vector sorted. Returns -1 if the
+ *    vector or the element is NULL.
  **/
-void vi_free(v_itr_t* const itr) {
-   free(itr);
+int v_bsearch(vect_t* const v, void* const elem,
+              int (*cmp)(const void*, const void*)) {
+   int index;
+
+   if(!v || !elem) return -1;
+
+   index = __v_bound(v, cmp, elem, 0);
+
+   if(index == v->__size || __v_compare(v, cmp, elem, __v_elem(v, index)))
+      index = -index - 1;
+
+   return index;
 }
 
 
 /**
- * Indicates whether or not the iterator has more elements. In other words,
- * returns 1 if vi_next(...) would return an element.
+ * Keeps a vector sorted from now on. The vector is sorted, elements added to
+ * it are placed in order regardless of the index given, v_set(...) is
+ * refused, and v_contains(...) and v_indexof(...) binary search using the
+ * ordering rather than comparing bytes.
  *
- * @param itr - the iterator to check against for more elements.
- * @return 1 if there exists more elements in the iterator. Returns 0 if the
- *    iterator is NULL or does not have anymore elements.
+ * @param v - the vector to keep sorted.
+ * @param cmp - the ordering to keep; see v_sort(...).
+ * @return 1 if the vector is now kept sorted. Returns 0 if the vector is NULL
+ *    or upon allocation error.
  **/
-int vi_hasnext(v_itr_t* const itr) {
-   if(!itr) return !EXIST;
+int v_keepsorted(vect_t* const v, int (*cmp)(const void*, const void*)) {
+   if(!v) return !ADDED;
 
-   /* There exists another element */
-   if(itr->pos == itr->vector->__size)
-      return !EXIST;
+   if(!v_sort(v, cmp)) return !ADDED;
 
-   return EXIST;
+   v->__cmp = cmp;
+   v->__flags |= V_SORTED;
+
+   return ADDED;
 }
 
 
 /**
- * Indicates whether or not the iterator has previous elements. In other words,
- * returns 1 if vi_prev(...) would return an element.
+ * Stops keeping a vector sorted. The elements are left in place.
  *
- * @param itr - the iterator to check against for previous elements.
- * @return 1 if there exists a previous element in the iterator. Returns 0 if
- *    the iterator is NULL of does not have any previous elements.
+ * @param v - the vector to stop keeping sorted.
  **/
-int vi_hasprev(v_itr_t* const itr) {
-   if(!itr) return !EXIST;
+void v_dropsorted(vect_t* const v) {
+   if(!v) return;
 
-   /* There exists a previous element */
-   return (itr->pos ? EXIST : !EXIST);
+   v->__flags &= ~V_SORTED;
 }
 
 
+/** File-Backed Vector Functions **/
+
 /**
- * Retrieves (but does not remove) the next element in the iterator.
+ * A simulated constructor for a file-backed vector. The elements are stored
+ * by value, as with v_init_inline(...), in a file that is mapped into
+ * memory; opening an existing file maps its elements in without reading
+ * them. The file grows with the vector. All other vector functions may be
+ * used on the vector as usual.
  *
- * @param itr - the iterator to return an element from.
- * @return the next element in the iterator. Returns NULL if the iterator is
- *    NULL or there are no more elements in the iterator.
+ * NOTE: This is a function that is not intended for use by the user. The user
+ * should instead use the macro v_mmap_open(path, type, flags), where type is
+ * the type that the user wishes to restrict the vector to.
+ *
+ * @param path - the file to store the vector in.
+ * @param __elem_size - the size of an element in the vector.
+ * @param flags - zero (0) or more of V_MMAP_CREATE, to create the file if it
+ *    does not exist, and V_MMAP_TRUNC, to discard any elements already in it.
+ * @return a pointer to the vector. Returns a NULL pointer if the file could
+ *    not be opened or mapped, was written with a different element size, or
+ *    is not a vector file, or upon allocation error.
  **/
-void* vi_next(v_itr_t* const itr) {
-   void *target;
+vect_t* __v_mmap_open(const char *path, size_t __elem_size, int flags) {
+#ifdef V_MAP
+   __v_mhdr_t *hdr;
+   struct stat st;
+   vect_t *vector;
+   size_t len;
+   char *map;
+   int fd, fresh;
 
-   if(!itr) return NULL;
+   if(!path || !__elem_size) return NULL;
 
-   /* If there are more elements */
-   if(!vi_hasnext(itr)) return NULL;
+   fd = open(path, O_RDWR | (flags & V_MMAP_CREATE ? O_CREAT : 0), 0644);
 
-   target = itr->vector->__elements[itr->pos];
-   itr->pos++;
+   if(fd < 0) return NULL;
 
-   return target;
+   if(fstat(fd, &st) < 0) {
+      close(fd);
+      return NULL;
+   }
+
+   len = (size_t) st.st_size;
+   fresh = (len == 0 || (flags & V_MMAP_TRUNC));
+
+   /* New or discarded file; lay out a header and room for a few elements */
+   if(fresh) {
+      len = sizeof(__v_mhdr_t) + INIT_SIZE * __elem_size;
+
+      if(ftruncate(fd, (off_t) len) < 0) {
+         close(fd);
+         return NULL;
+      }
+   }
+
+   if(len < sizeof(__v_mhdr_t)) {
+      close(fd);
+      return NULL;
+   }
+
+   map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+   if(map == MAP_FAILED) {
+      close(fd);
+      return NULL;
+   }
+
+   hdr = (__v_mhdr_t*) map;
+
+   if(fresh) {
+      memset(hdr, 0, sizeof(__v_mhdr_t));
+      memcpy(hdr->magic, MAP_MAGIC, sizeof(hdr->magic));
+      hdr->elem_size = __elem_size;
+      hdr->size = 0;
+   }
+
+   vector = malloc(sizeof(vect_t));
+
+   /* Refuse files that do not hold a vector of this element size */
+   if(!vector || memcmp(hdr->magic, MAP_MAGIC, sizeof(hdr->magic)) ||
+         hdr->elem_size != __elem_size ||
+         hdr->size > (len - sizeof(__v_mhdr_t)) / __elem_size) {
+      free(vector);
+      munmap(map, len);
+      close(fd);
+      return NULL;
+   }
+
+   vector->__spare = malloc(__elem_size);
+
+   if(!vector->__spare) {
+      free(vector);
+      munmap(map, len);
+      close(fd);
+      return NULL;
+   }
+
+   vector->__data = map + sizeof(__v_mhdr_t);
+   vector->__elem_size = __elem_size;
+   vector->__slot_size = __elem_size;
+   vector->__cap = (int) ((len - sizeof(__v_mhdr_t)) / __elem_size);
+   vector->__size = (int) hdr->size;
+   vector->__head = 0;
+   vector->__flags = V_INLINE | V_MAPPED;
+   vector->__cmp = V_CMP_MEM;
+   vector->__fd = fd;
+
+   return vector;
+#else
+   return NULL;
+#endif
 }
 
 
 /**
- * Retrieves (but does not remove) the previous element in the iterator.
+ * Flushes a file-backed vector, including its size, to its file and waits
+ * for the write to complete. Does nothing for other vectors.
  *
- * @param itr - the iterator to return an element from.
- * @return the previous element in the iterator. Returns NULL if the iterator
- *    is NULL or there are no previous elements in the iterator.
+ * @param v - the vector to flush.
+ * @return 1 if the vector was flushed or is not file-backed. Returns 0 if the
+ *    vector is NULL or the flush failed.
  **/
-void* vi_prev(v_itr_t* const itr) {
-   void *target;
+int v_sync(vect_t* const v) {
+#ifdef V_MAP
+   __v_mhdr_t *hdr;
+#endif
 
-   if(!itr) return NULL;
+   if(!v) return !ADDED;
 
-   /* If there are more elements */
-   if(!vi_hasprev(itr)) return NULL;
+   if(!(v->__flags & V_MAPPED)) return ADDED;
 
-   target = itr->vector->__elements[itr->pos];
-   itr->pos--;
+#ifdef V_MAP
+   if(!v->__data) return !ADDED;
 
-   return target;
+   hdr = (__v_mhdr_t*) (v->__data - sizeof(__v_mhdr_t));
+   hdr->size = (uint64_t) v->__size;
+
+   if(msync(hdr, sizeof(__v_mhdr_t) + (size_t) v->__cap * v->__slot_size,
+            MS_SYNC) < 0)
+      return !ADDED;
+#endif
+
+   return ADDED;
 }
 
+
+/**
+ * Resize the file behind a file-backed vector and its mapping to hold
+ * exactly the specified number of elements.
+ *
+ * @param v - the file-backed vector to resize.
+ * @param cap - the new capacity; not less than the size of the vector.
+ * @return 1 if the vector was resized. Returns 0 if the file could not be
+ *    resized or remapped, in which case the vector is left untouched; or,
+ *    should the file then not map again at its old size, left empty with no
+ *    mapping, failing every later resize and sync. The elements stay in the
+ *    file, as of the last sync.
+ **/
+static int __v_remap(vect_t* const v, int cap) {
+#ifdef V_MAP
+   size_t old, len;
+   char *map;
+
+   if(!v->__data) return !ADDED;
+
+   if(cap < 1) cap = 1;
+
+   old = sizeof(__v_mhdr_t) + (size_t) v->__cap * v->__slot_size;
+   len = sizeof(__v_mhdr_t) + (size_t) cap * v->__slot_size;
+   map = v->__data - sizeof(__v_mhdr_t);
+
+   /* Size the file first; nothing is touched past its end meanwhile */
+   if(ftruncate(v->__fd, (off_t) len) < 0)
+      return !ADDED;
+
+#ifdef MREMAP_MAYMOVE
+   map = mremap(map, old, len, MREMAP_MAYMOVE);
+#else
+   munmap(map, old);
+   map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, v->__fd, 0);
+#endif
+
+   if(map == MAP_FAILED) {
+      /* A file left longer only holds unused slots, so carry on regardless */
+      if(ftruncate(v->__fd, (off_t) old) < 0)
+         ;
+
+#ifndef MREMAP_MAYMOVE
+      /* The old mapping is gone; map the file as it was */
+      map = mmap(NULL, old, PROT_READ | PROT_WRITE, MAP_SHARED, v->__fd, 0);
+
+      if(map == MAP_FAILED) {
+         v->__data = NULL;
+         v->__cap = 0;
+         v->__size = 0;
+         v->__head = 0;
+         return !ADDED;
+      }
+
+      v->__data = map + sizeof(__v_mhdr_t);
+#endif
+
+      return !ADDED;
+   }
+
+   v->__data = map + sizeof(__v_mhdr_t);
+   v->__cap = cap;
+
+   return ADDED;
+#else
+   return !ADDED;
+#endif
+}
@@ -0,0 +1,71 @@
+/**
+ * libdstructs: a simple, generic data structures library written in ANSI C.
+ *
+ * Copyright (C) 2013, 2014 Evan Bezeredi <bezeredi.dev@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see {http://www.gnu.org/licenses/}.
+ **/
+#include <string.h>
+#include "ctest.h"
+#include "dstructs.h"
+
+typedef struct {
+	int value;
+	ill_hook_t all;
+	ill_hook_t even;
+} item_t;
+
+
+CTEST(ilist, two_lists_test){
+	item_t items[10], *e, *n;
+	ill_t all, even;
+	int i;
+
+	memset(items, 0, sizeof(items));
+	ill_init(&all, item_t, all);
+	ill_init(&even, item_t, even);
+
+	for(i = 0; i < 10; i++) {
+		items[i].value = i;
+		ASSERT_TRUE(ill_addl(&all, &items[i]));
+
+		if(i % 2 == 0)
+			ASSERT_TRUE(ill_addf(&even, &items[i]));
+	}
+
+	ASSERT_FALSE(ill_addl(&all, &items[3]));
+	ASSERT_EQUAL(10, ill_size(&all));
+	ASSERT_EQUAL(5, ill_size(&even));
+	ASSERT_EQUAL(8, ((item_t*) ill_first(&even))->value);
+
+	/* Unlink by hook alone, then by element */
+	ill_unlink(&items[4].all);
+	ASSERT_FALSE(ill_linked(&items[4].all));
+	ASSERT_TRUE(ill_linked(&items[4].even));
+	ASSERT_EQUAL(5, ((item_t*) ill_next(&all, &items[3]))->value);
+	ASSERT_EQUAL(6, ((item_t*) ill_rem(&even, &items[6]))->value);
+
+	i = 0;
+	ill_foreach_safe(&all, e, n)
+		if(e->value % 3 == 0)
+			ill_rem(&all, e);
+		else
+			i += e->value;
+	ASSERT_EQUAL(1 + 2 + 5 + 7 + 8, i);
+
+	ASSERT_EQUAL(8, ill_entry(&items[8].all, item_t, all)->value);
+	ASSERT_EQUAL(8, ((item_t*) ill_reml(&all))->value);
+	ASSERT_EQUAL(0, ((item_t*) ill_reml(&even))->value);
+	ASSERT_EQUAL(4, ill_size(&all));
+}
@@ -16,6 +16,7 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see {http://www.gnu.org/licenses/}.
  **/
+#include <stdlib.h>
 #include "ctest.h"
 #include "dstructs.h"
 
@@ -42,3 +43,449 @@ CTEST2(intlist, length_test){
 	ASSERT_EQUAL(3, ll_size(data->l));
 }
 
+
+CTEST(intlist, foreach_test){
+	llist_t *l = ll_init(int);
+	ll_cur_t cur;
+	int *elem;
+	int i, sum = 0;
+
+	for(i = 0; i < 10; i++) {
+		elem = malloc(sizeof(int));
+		*elem = i;
+		ll_addl(l, elem);
+	}
+
+	ll_foreach(l, elem, cur)
+		sum += *elem;
+
+	ASSERT_EQUAL(45, sum);
+	ASSERT_EQUAL(9, *(int*) lc_prev(&cur));
+
+	ASSERT_TRUE(ll_cur(l, &cur, 4));
+	ASSERT_EQUAL(4, *(int*) lc_next(&cur));
+
+	ll_free(l);
+}
+
+static int below(void* const elem, void* ctx){
+	return *(int*) elem < *(int*) ctx;
+}
+
+CTEST(intlist, remove_if_test){
+	llist_t *l = ll_init(int);
+	int *elem;
+	int i, bound = 5;
+
+	for(i = 0; i < 10; i++) {
+		elem = malloc(sizeof(int));
+		*elem = i;
+		ll_addl(l, elem);
+	}
+
+	ASSERT_EQUAL(5, ll_remove_if(l, below, &bound, free));
+	ASSERT_EQUAL(5, ll_size(l));
+	ASSERT_EQUAL(5, *(int*) ll_first(l));
+
+	bound = 7;
+	ASSERT_EQUAL(3, ll_retain(l, below, &bound, free));
+	ASSERT_EQUAL(6, *(int*) ll_last(l));
+
+	ll_free(l);
+}
+
+CTEST(intlist, pool_test){
+	ll_pool_t *pool = ll_pool_init();
+	llist_t *a = ll_init(int);
+	llist_t *b = ll_init(int);
+	int *elem;
+	int i;
+
+	ASSERT_TRUE(ll_setpool(a, pool));
+	ASSERT_TRUE(ll_setpool(b, pool));
+	ll_pool_free(pool);
+
+	for(i = 0; i < 1000; i++) {
+		elem = malloc(sizeof(int));
+		*elem = i;
+		ll_addl(i % 2 ? a : b, elem);
+	}
+
+	ASSERT_EQUAL(500, ll_size(a));
+	ASSERT_EQUAL(998, *(int*) ll_last(b));
+	ASSERT_FALSE(ll_setpool(a, pool = ll_pool_init()));
+
+	ll_pool_free(pool);
+	ll_free(a);
+	ll_free(b);
+}
+
+
+CTEST(intlist, index_test){
+	llist_t *list = ll_init(int);
+	int vals[100];
+	void **arr;
+	int i;
+
+	/* Build 0..99 by inserting the odd values between the even ones */
+	for(i = 0; i < 100; i++) vals[i] = i;
+	for(i = 0; i < 100; i += 2) ll_addl(list, &vals[i]);
+	for(i = 1; i < 100; i += 2) ll_add(list, i, &vals[i]);
+
+	/* Alternate between the ends and the middle */
+	for(i = 0; i < 50; i++) {
+		ASSERT_EQUAL(i, *(int*) ll_get(list, i));
+		ASSERT_EQUAL(99 - i, *(int*) ll_get(list, 99 - i));
+	}
+
+	ASSERT_EQUAL(50, *(int*) ll_rem(list, 50));
+	ASSERT_EQUAL(51, *(int*) ll_get(list, 50));
+	ASSERT_EQUAL(49, *(int*) ll_set(list, 49, &vals[0]));
+
+	arr = ll_toarr(list);
+	ASSERT_EQUAL(0, *(int*) arr[49]);
+	ASSERT_EQUAL(99, *(int*) arr[98]);
+	free(arr);
+
+	while(ll_size(list)) ll_reml(list);
+	ll_free(list);
+}
+
+
+CTEST(intlist, unrolled_test){
+	llist_t *list = ll_init_unrolled(int, 4);
+	int vals[40];
+	ll_cur_t cur;
+	int *elem;
+	int i;
+
+	for(i = 0; i < 40; i++) vals[i] = i;
+	for(i = 0; i < 40; i += 2) ll_addl(list, &vals[i]);
+	for(i = 1; i < 40; i += 2) ll_add(list, i, &vals[i]);
+
+	i = 0;
+	ll_foreach(list, elem, cur)
+		ASSERT_EQUAL(i++, *elem);
+	ASSERT_EQUAL(40, i);
+
+	for(i = 0; i < 30; i++) ll_rem(list, 5);
+	ASSERT_EQUAL(10, ll_size(list));
+	ASSERT_EQUAL(4, *(int*) ll_get(list, 4));
+	ASSERT_EQUAL(35, *(int*) ll_get(list, 5));
+	ASSERT_EQUAL(9, ll_indexof(list, &vals[39]));
+	ASSERT_EQUAL(39, *(int*) ll_last(list));
+
+	while(ll_size(list)) ll_remf(list);
+	ll_free(list);
+}
+
+
+CTEST(intlist, indexed_test){
+	llist_t *list = ll_init_indexed(int);
+	int vals[1000];
+	int i;
+
+	/* Insert each value at the middle of what will be 0..999 */
+	for(i = 0; i < 1000; i++) vals[i] = i;
+	for(i = 0; i < 500; i++) ll_addl(list, &vals[i]);
+	for(i = 999; i >= 500; i--) ll_add(list, 500, &vals[i]);
+
+	for(i = 0; i < 1000; i += 37)
+		ASSERT_EQUAL(i, *(int*) ll_get(list, i));
+
+	ASSERT_EQUAL(500, *(int*) ll_rem(list, 500));
+	ASSERT_EQUAL(501, *(int*) ll_get(list, 500));
+	ASSERT_EQUAL(999, *(int*) ll_get(list, 998));
+
+	while(ll_size(list)) ll_remf(list);
+	ll_free(list);
+}
+
+
+CTEST(intlist, splice_test){
+	llist_t *a = ll_init(int);
+	llist_t *b = ll_init(int);
+	llist_t *sub;
+	int vals[10];
+	int i;
+
+	for(i = 0; i < 10; i++) vals[i] = i;
+	for(i = 0; i < 10; i++) ll_addl(i < 3 || i > 6 ? a : b, &vals[i]);
+
+	ASSERT_TRUE(ll_splice(a, 3, b));
+	ASSERT_EQUAL(0, ll_size(b));
+	ASSERT_EQUAL(10, ll_size(a));
+
+	for(i = 0; i < 10; i++)
+		ASSERT_EQUAL(i, *(int*) ll_get(a, i));
+
+	sub = ll_sub(a, 2, 5);
+	ASSERT_EQUAL(3, ll_size(sub));
+	ASSERT_EQUAL(2, *(int*) ll_first(sub));
+	ASSERT_EQUAL(5, *(int*) ll_get(a, 2));
+
+	ASSERT_TRUE(ll_concat(b, sub));
+	ASSERT_TRUE(ll_concat(b, a));
+	ASSERT_EQUAL(10, ll_size(b));
+	ASSERT_EQUAL(9, *(int*) ll_last(b));
+
+	while(ll_size(b)) ll_remf(b);
+	ll_free(sub);
+	ll_free(a);
+	ll_free(b);
+}
+
+
+CTEST(intlist, sub_pool_test){
+	llist_t *a = ll_init_inline(int);
+	llist_t *b = ll_init_inline(int);
+	llist_t *sub;
+	void *node;
+	int i;
+
+	for(i = 0; i < 10; i++) ll_addl(a, &i);
+	ll_addl(b, &i);
+
+	/* Once the sublist is gone the pool is private again */
+	sub = ll_sub(a, 2, 5);
+	ASSERT_EQUAL(3, ll_size(sub));
+	ll_free(sub);
+
+	/* So its nodes are relinked, not copied */
+	node = ll_first(a);
+	ASSERT_TRUE(ll_concat(b, a));
+	ASSERT_TRUE(node == ll_get(b, 1));
+	ASSERT_EQUAL(9, *(int*) ll_last(b));
+	ASSERT_EQUAL(8, ll_size(b));
+
+	ll_free(a);
+	ll_free(b);
+}
+
+
+CTEST(intlist, sort_test){
+	llist_t *list = ll_init(int);
+	unsigned char bytes[5] = {5, 3, 9, 1, 7};
+	int vals[100];
+	ll_cur_t cur;
+	int *elem, *prev;
+	int i;
+
+	/* Pairs of equal keys show whether the sort is stable */
+	for(i = 0; i < 100; i++) {
+		vals[i] = (i * 37) % 50;
+		ll_addl(list, &vals[i]);
+	}
+
+	ASSERT_TRUE(ll_sort(list, LL_CMP_INT));
+
+	prev = NULL;
+	ll_foreach(list, elem, cur) {
+		if(prev) ASSERT_TRUE(*prev < *elem || (*prev == *elem && prev < elem));
+		prev = elem;
+	}
+
+	ASSERT_EQUAL(49, *(int*) ll_last(list));
+	ASSERT_EQUAL(100, ll_size(list));
+
+	while(ll_size(list)) ll_remf(list);
+	ll_free(list);
+
+	/* Bytes, ordered as memcmp(...) would */
+	list = ll_init(unsigned char);
+	for(i = 0; i < 5; i++) ll_addl(list, &bytes[i]);
+
+	ASSERT_TRUE(ll_sort(list, LL_CMP_MEM));
+	ASSERT_EQUAL(1, *(unsigned char*) ll_first(list));
+	ASSERT_EQUAL(5, *(unsigned char*) ll_get(list, 2));
+	ASSERT_EQUAL(9, *(unsigned char*) ll_last(list));
+
+	while(ll_size(list)) ll_remf(list);
+	ll_free(list);
+}
+
+
+CTEST(intlist, iterator_edit_test){
+	llist_t *list = ll_init(int);
+	int vals[20], extra = 100;
+	ll_itr_t *itr;
+	int *elem;
+	int i;
+
+	for(i = 0; i < 20; i++) {
+		vals[i] = i;
+		ll_addl(list, &vals[i]);
+	}
+
+	/* Drop odd values, double up multiples of five */
+	itr = ll_itr(list, 0);
+	while(li_hasnext(itr)) {
+		elem = li_next(itr);
+
+		if(*elem % 2)
+			ASSERT_EQUAL(*elem, *(int*) li_rem(itr));
+		else if(*elem % 5 == 0)
+			ASSERT_TRUE(li_add(itr, &extra));
+	}
+
+	ASSERT_NULL(li_rem(itr));
+	ASSERT_EQUAL(18, *(int*) li_prev(itr));
+	ASSERT_EQUAL(18, *(int*) li_set(itr, &extra));
+	li_free(itr);
+
+	ASSERT_EQUAL(12, ll_size(list));
+	ASSERT_EQUAL(100, *(int*) ll_get(list, 1));
+	ASSERT_EQUAL(10, *(int*) ll_get(list, 6));
+	ASSERT_EQUAL(100, *(int*) ll_get(list, 7));
+	ASSERT_EQUAL(100, *(int*) ll_last(list));
+
+	while(ll_size(list)) ll_remf(list);
+	ll_free(list);
+}
+
+
+CTEST(intlist, compact_test){
+	llist_t *list = ll_init_unrolled(int, 4);
+	int vals[200];
+	int i;
+
+	/* Interleave inserts at both ends so nodes are out of order */
+	for(i = 0; i < 200; i++) {
+		vals[i] = i;
+		ll_add(list, (i % 3 ? ll_size(list) / 2 : 0), &vals[i]);
+	}
+
+	for(i = 0; i < 50; i++) ll_rem(list, i);
+
+	ASSERT_TRUE(ll_fragmentation(list) > 0);
+	ASSERT_TRUE(ll_compact(list));
+	ASSERT_EQUAL(0, ll_fragmentation(list));
+	ASSERT_EQUAL(150, ll_size(list));
+
+	while(ll_size(list) > 1) {
+		ASSERT_NOT_NULL(ll_get(list, ll_size(list) - 1));
+		ll_remf(list);
+	}
+
+	ll_remf(list);
+	ll_free(list);
+}
+
+
+CTEST(intlist, hashindex_test){
+	llist_t *list = ll_init(int);
+	int vals[100];
+	int i, key;
+
+	for(i = 0; i < 100; i++) {
+		vals[i] = i * 10;
+		ll_addl(list, &vals[i]);
+	}
+
+	ASSERT_TRUE(ll_hashindex(list, 1));
+
+	key = 420;
+	ASSERT_TRUE(ll_contains(list, &key));
+	ASSERT_EQUAL(42, ll_indexof(list, &key));
+
+	/* Least recently used goes last */
+	ASSERT_TRUE(ll_tofront(list, &key));
+	ASSERT_EQUAL(420, *(int*) ll_first(list));
+	ASSERT_EQUAL(0, ll_indexof(list, &key));
+	ASSERT_EQUAL(990, *(int*) ll_reml(list));
+
+	key = 990;
+	ASSERT_FALSE(ll_contains(list, &key));
+	ASSERT_FALSE(ll_tofront(list, &key));
+
+	key = 70;
+	ASSERT_EQUAL(70, *(int*) ll_remval(list, &key));
+	ASSERT_NULL(ll_remval(list, &key));
+	ASSERT_EQUAL(98, ll_size(list));
+
+	/* Replacing an element rehashes it */
+	key = 5;
+	ll_set(list, 3, &key);
+	ASSERT_EQUAL(3, ll_indexof(list, &key));
+	ASSERT_TRUE(ll_toback(list, &key));
+	ASSERT_EQUAL(97, ll_indexof(list, &key));
+
+	while(ll_size(list)) ll_remf(list);
+	ll_free(list);
+
+	list = ll_init_unrolled(int, 0);
+	ASSERT_FALSE(ll_hashindex(list, 1));
+	ll_free(list);
+}
+
+
+CTEST(intlist, inline_test){
+	llist_t *list = ll_init_inline(int);
+	int i, out;
+
+	/* Elements are copied in, so one variable serves every add */
+	for(i = 0; i < 10; i++)
+		ll_addl(list, &i);
+
+	i = 42;
+	ASSERT_EQUAL(3, *(int*) ll_set(list, 3, &i));
+	ASSERT_EQUAL(42, *(int*) ll_get(list, 3));
+
+	ASSERT_TRUE(ll_remf_into(list, &out));
+	ASSERT_EQUAL(0, out);
+	ASSERT_EQUAL(9, *(int*) ll_reml(list));
+	ASSERT_EQUAL(8, ll_size(list));
+
+	ll_free(list);
+}
+
+
+CTEST(intlist, unrolled_inline_test){
+	llist_t *list = ll_init_unrolled_inline(int, 4);
+	ll_cur_t cur;
+	int *elem;
+	int i, out;
+
+	/* Fill from both ends and the middle so nodes split and shift */
+	for(i = 0; i < 40; i += 2) ll_addl(list, &i);
+	for(i = 1; i < 40; i += 2) ll_add(list, i, &i);
+
+	i = 0;
+	ll_foreach(list, elem, cur)
+		ASSERT_EQUAL(i++, *elem);
+	ASSERT_EQUAL(40, i);
+
+	i = 77;
+	ASSERT_EQUAL(5, *(int*) ll_set(list, 5, &i));
+	ASSERT_EQUAL(77, *(int*) ll_get(list, 5));
+	ASSERT_EQUAL(5, ll_indexof(list, &i));
+	ASSERT_TRUE(ll_tofront(list, &i));
+	ASSERT_EQUAL(77, *(int*) ll_first(list));
+
+	/* Removing copies the element out before the slots close up */
+	ASSERT_EQUAL(77, *(int*) ll_remf(list));
+	for(i = 0; i < 20; i++) ll_rem(list, 10);
+	ASSERT_TRUE(ll_rem_into(list, 0, &out));
+	ASSERT_EQUAL(0, out);
+	ASSERT_EQUAL(18, ll_size(list));
+	ASSERT_EQUAL(39, *(int*) ll_last(list));
+
+	out = 10;
+	ASSERT_EQUAL(8, ll_remove_if(list, below, &out, NULL));
+	ASSERT_EQUAL(10, *(int*) ll_first(list));
+	ASSERT_EQUAL(10, ll_size(list));
+
+	out = 39;
+	ASSERT_TRUE(ll_tofront(list, &out));
+	ASSERT_TRUE(ll_sort(list, LL_CMP_INT));
+	ASSERT_TRUE(ll_compact(list));
+
+	out = -1;
+	ll_foreach(list, elem, cur) {
+		ASSERT_TRUE(out < *elem);
+		out = *elem;
+	}
+
+	ll_free(list);
+	ASSERT_NULL(ll_init_unrolled_inline(int, -1));
+}
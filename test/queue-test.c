@@ -0,0 +1,440 @@
+/**
+ * libdstructs: a simple, generic data structures library written in ANSI C.
+ *
+ * Copyright (C) 2013, 2014 Evan Bezeredi <bezeredi.dev@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see {http://www.gnu.org/licenses/}.
+ **/
+#define _POSIX_C_SOURCE 199309L  /* For nanosleep(...), clock_gettime(...) */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "ctest.h"
+#include "dstructs.h"
+
+
+CTEST(queue, inline_test){
+	que_t *q = q_init_inline(int);
+	int i, out;
+
+	/* Elements are copied in, so one variable serves every enqueue */
+	for(i = 0; i < 10; i++)
+		q_enq(q, &i);
+
+	ASSERT_TRUE(q_deq_into(q, &out));
+	ASSERT_EQUAL(0, out);
+	ASSERT_EQUAL(1, *(int*) q_deq(q));
+	ASSERT_EQUAL(8, q_size(q));
+
+	q_free(q);
+}
+
+
+CTEST(queue, ring_test){
+	que_t *q = q_init_ring_inline(int, 4);
+	int i, out;
+
+	/* Wrap around, then grow while wrapped */
+	for(i = 0; i < 12; i++) q_enq(q, &i);
+	for(i = 0; i < 10; i++) q_deq(q);
+	for(i = 12; i < 40; i++) q_enq(q, &i);
+
+	ASSERT_EQUAL(30, q_size(q));
+	ASSERT_EQUAL(10, *(int*) q_head(q));
+	ASSERT_EQUAL(39, *(int*) q_tail(q));
+
+	for(i = 10; i < 40; i++) {
+		ASSERT_TRUE(q_deq_into(q, &out));
+		ASSERT_EQUAL(i, out);
+	}
+
+	ASSERT_FALSE(q_deq_into(q, &out));
+	ASSERT_NULL(q_head(q));
+	q_free(q);
+}
+
+
+CTEST(queue, ring_pointer_test){
+	que_t *q = q_init_ring(int, 0);
+	int vals[100];
+	void **arr;
+	int i;
+
+	for(i = 0; i < 100; i++) {
+		vals[i] = i;
+		q_enq(q, &vals[i]);
+	}
+
+	arr = q_toarr(q);
+	ASSERT_EQUAL(99, *(int*) arr[99]);
+	free(arr);
+
+	for(i = 0; i < 100; i++)
+		ASSERT_EQUAL(i, *(int*) q_deq(q));
+
+	ASSERT_NULL(q_deq(q));
+	q_free(q);
+}
+
+
+CTEST(queue, batch_test){
+	que_t *ring = q_init_ring_inline(int, 4);
+	que_t *list = q_init(int);
+	stack_t *s = s_init_inline(int);
+	int in[50], out[50];
+	void *ptrs[3], *got[3];
+	int i;
+
+	for(i = 0; i < 50; i++) in[i] = i;
+
+	/* Wrap the ring first so both copies split in two */
+	ASSERT_EQUAL(3, q_enq_n(ring, in, 3));
+	ASSERT_EQUAL(2, q_deq_n(ring, out, 2));
+	ASSERT_EQUAL(50, q_enq_n(ring, in, 50));
+	ASSERT_EQUAL(51, q_deq_n(ring, out, 50) + q_size(ring));
+	ASSERT_EQUAL(2, out[0]);
+	ASSERT_EQUAL(48, out[49]);
+	ASSERT_EQUAL(1, q_deq_n(ring, out, 50));
+	ASSERT_EQUAL(49, out[0]);
+
+	/* Pointers stop at the first NULL */
+	ptrs[0] = &in[7];
+	ptrs[1] = NULL;
+	ptrs[2] = &in[8];
+	ASSERT_EQUAL(1, q_enq_n(list, ptrs, 3));
+	ASSERT_EQUAL(1, q_deq_n(list, got, 3));
+	ASSERT_EQUAL(7, *(int*) got[0]);
+
+	/* The last pushed is popped first */
+	ASSERT_EQUAL(10, s_push_n(s, in, 10));
+	ASSERT_EQUAL(4, s_pop_n(s, out, 4));
+	ASSERT_EQUAL(9, out[0]);
+	ASSERT_EQUAL(6, out[3]);
+	ASSERT_EQUAL(6, s_size(s));
+
+	q_free(ring);
+	q_free(list);
+	s_free(s);
+}
+
+
+CTEST(queue, spsc_test){
+	q_spsc_t *q = q_spsc_init(long, 16);
+	long in[40], out[40], v;
+	int i;
+
+	for(i = 0; i < 40; i++) in[i] = i * 3;
+
+	/* Fill past capacity, then drain across the wrap */
+	ASSERT_EQUAL(10, q_spsc_enq_n(q, in, 10));
+	ASSERT_EQUAL(6, q_spsc_enq_n(q, in + 10, 30));
+	ASSERT_FALSE(q_spsc_enq(q, &in[16]));
+	ASSERT_EQUAL(16, q_spsc_size(q));
+
+	ASSERT_EQUAL(12, q_spsc_deq_n(q, out, 12));
+	ASSERT_EQUAL(33, out[11]);
+
+	for(i = 16; i < 26; i++)
+		ASSERT_TRUE(q_spsc_enq(q, &in[i]));
+
+	for(i = 12; i < 26; i++) {
+		ASSERT_TRUE(q_spsc_deq(q, &v));
+		ASSERT_EQUAL(i * 3, v);
+	}
+
+	ASSERT_FALSE(q_spsc_deq(q, &v));
+	ASSERT_EQUAL(0, q_spsc_deq_n(q, out, 5));
+	q_spsc_free(q);
+}
+
+
+#define SPSC_ITEMS 200000L
+
+/**
+ * Enqueue 0 to SPSC_ITEMS - 1, alternating single and batched enqueues, and
+ * yield whenever the ring is full.
+ **/
+static void* spsc_producer(void* arg){
+	q_spsc_t *q = arg;
+	long i, k, buf[32];
+	int n;
+
+	for(i = 0; i < SPSC_ITEMS; ) {
+		if((i / 7) % 2) {
+			n = (int) (SPSC_ITEMS - i < 32 ? SPSC_ITEMS - i : 32);
+
+			for(k = 0; k < n; k++) buf[k] = i + k;
+			n = q_spsc_enq_n(q, buf, n);
+		}
+		else
+			n = q_spsc_enq(q, &i);
+
+		if(!n) sched_yield();
+		i += n;
+	}
+
+	return NULL;
+}
+
+
+CTEST(queue, spsc_thread_test){
+	q_spsc_t *q = q_spsc_init(long, 64);
+	pthread_t producer;
+	long i, k, v, buf[32], bad;
+	int n;
+
+	ASSERT_EQUAL(0, pthread_create(&producer, NULL, spsc_producer, q));
+
+	/* Every element arrives once and in order while the ring wraps */
+	bad = 0;
+
+	for(i = 0; i < SPSC_ITEMS; i += n) {
+		if(i % 3) {
+			n = q_spsc_deq_n(q, buf, 32);
+		}
+		else {
+			n = q_spsc_deq(q, &v);
+			buf[0] = v;
+		}
+
+		if(!n) sched_yield();
+
+		for(k = 0; k < n; k++)
+			if(buf[k] != i + k) bad++;
+	}
+
+	ASSERT_EQUAL(0, pthread_join(producer, NULL));
+	ASSERT_EQUAL(0, bad);
+	ASSERT_EQUAL(0, q_spsc_size(q));
+	q_spsc_free(q);
+}
+
+
+CTEST(queue, mpmc_test){
+	q_mpmc_t *q = q_mpmc_init(int, 16);
+	int in[20], out[20], v;
+	int i;
+
+	for(i = 0; i < 20; i++) in[i] = i + 100;
+
+	ASSERT_EQUAL(16, q_mpmc_try_enq_n(q, in, 20));
+	ASSERT_FALSE(q_mpmc_try_enq(q, &in[16]));
+	ASSERT_EQUAL(16, q_mpmc_size(q));
+
+	ASSERT_EQUAL(5, q_mpmc_try_deq_n(q, out, 5));
+	ASSERT_EQUAL(104, out[4]);
+
+	/* Cells freed at the front are reused past the wrap */
+	for(i = 16; i < 20; i++)
+		ASSERT_TRUE(q_mpmc_try_enq(q, &in[i]));
+
+	for(i = 5; i < 20; i++) {
+		ASSERT_TRUE(q_mpmc_try_deq(q, &v));
+		ASSERT_EQUAL(i + 100, v);
+	}
+
+	ASSERT_FALSE(q_mpmc_try_deq(q, &v));
+	q_mpmc_free(q);
+}
+
+
+#define MPMC_THREADS 4
+#define MPMC_ITEMS 20000L
+
+static q_mpmc_t *mpmc_q;
+static unsigned char mpmc_seen[MPMC_THREADS * MPMC_ITEMS];
+static long mpmc_bad;
+
+/**
+ * Enqueue the elements of one producer, p * MPMC_ITEMS + 0 to MPMC_ITEMS - 1,
+ * alternating single and batched enqueues.
+ **/
+static void* mpmc_producer(void* arg){
+	long p, i, k, buf[16];
+	int n;
+
+	p = (long) arg;
+
+	for(i = 0; i < MPMC_ITEMS; i += n) {
+		if(i % 5 == 0) {
+			n = (int) (MPMC_ITEMS - i < 16 ? MPMC_ITEMS - i : 16);
+
+			for(k = 0; k < n; k++) buf[k] = p * MPMC_ITEMS + i + k;
+			n = q_mpmc_try_enq_n(mpmc_q, buf, n);
+		}
+		else {
+			buf[0] = p * MPMC_ITEMS + i;
+			n = q_mpmc_try_enq(mpmc_q, buf);
+		}
+
+		if(!n) sched_yield();
+	}
+
+	return NULL;
+}
+
+
+/**
+ * Dequeue MPMC_ITEMS elements, marking each as seen and counting any element
+ * of a producer that arrives before one enqueued earlier by that producer.
+ **/
+static void* mpmc_consumer(void* arg){
+	long last[MPMC_THREADS], got, v, buf[16];
+	int k, n, p;
+
+	(void) arg;
+
+	for(p = 0; p < MPMC_THREADS; p++) last[p] = -1;
+
+	for(got = 0; got < MPMC_ITEMS; got += n) {
+		if(got % 3 == 0) {
+			n = (int) (MPMC_ITEMS - got < 16 ? MPMC_ITEMS - got : 16);
+			n = q_mpmc_try_deq_n(mpmc_q, buf, n);
+		}
+		else {
+			n = q_mpmc_try_deq(mpmc_q, &v);
+			buf[0] = v;
+		}
+
+		if(!n) sched_yield();
+
+		for(k = 0; k < n; k++) {
+			v = buf[k];
+			p = (int) (v / MPMC_ITEMS);
+
+			if(v <= last[p])
+				__atomic_add_fetch(&mpmc_bad, 1, __ATOMIC_RELAXED);
+
+			last[p] = v;
+			__atomic_add_fetch(&mpmc_seen[v], 1, __ATOMIC_RELAXED);
+		}
+	}
+
+	return NULL;
+}
+
+
+CTEST(queue, mpmc_thread_test){
+	pthread_t threads[2 * MPMC_THREADS];
+	long i, once;
+
+	mpmc_q = q_mpmc_init(long, 64);
+	mpmc_bad = 0;
+
+	for(i = 0; i < MPMC_THREADS; i++) {
+		ASSERT_EQUAL(0, pthread_create(&threads[i], NULL, mpmc_producer,
+		                               (void*) i));
+		ASSERT_EQUAL(0, pthread_create(&threads[MPMC_THREADS + i], NULL,
+		                               mpmc_consumer, NULL));
+	}
+
+	for(i = 0; i < 2 * MPMC_THREADS; i++)
+		ASSERT_EQUAL(0, pthread_join(threads[i], NULL));
+
+	/* Each element was taken exactly once, in its producer's order */
+	for(i = 0, once = 0; i < MPMC_THREADS * MPMC_ITEMS; i++)
+		once += (mpmc_seen[i] == 1);
+
+	ASSERT_EQUAL(MPMC_THREADS * MPMC_ITEMS, once);
+	ASSERT_EQUAL(0, mpmc_bad);
+	ASSERT_EQUAL(0, q_mpmc_size(mpmc_q));
+	q_mpmc_free(mpmc_q);
+}
+
+
+CTEST(queue, mpmc_wait_test){
+	q_mpmc_t *q = q_mpmc_init(int, 16);
+	int i, v;
+
+	/* Nothing to wait for on one thread; both sides time out */
+	ASSERT_FALSE(q_mpmc_deq_wait(q, &v, 1000000L));
+
+	for(i = 0; i < 16; i++)
+		ASSERT_TRUE(q_mpmc_enq_wait(q, &i, 0));
+
+	ASSERT_FALSE(q_mpmc_enq_wait(q, &i, 1000000L));
+	ASSERT_TRUE(q_mpmc_deq_wait(q, &v, -1));
+	ASSERT_EQUAL(0, v);
+	ASSERT_TRUE(q_mpmc_enq_wait(q, &i, -1));
+	q_mpmc_free(q);
+}
+
+
+/* Sleep for a while, then enqueue 42 to wake a waiting consumer */
+static void* mpmc_late_enq(void* arg){
+	struct timespec pause = {0, 50000000L};
+	int v = 42;
+
+	nanosleep(&pause, NULL);
+	q_mpmc_try_enq(arg, &v);
+
+	return NULL;
+}
+
+
+/* Sleep for a while, then dequeue one element to wake a waiting producer */
+static void* mpmc_late_deq(void* arg){
+	struct timespec pause = {0, 50000000L};
+	int v;
+
+	nanosleep(&pause, NULL);
+	q_mpmc_try_deq(arg, &v);
+
+	return NULL;
+}
+
+
+/* Seconds since an earlier reading of the monotonic clock */
+static double since(struct timespec* start){
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double) (now.tv_sec - start->tv_sec) +
+	       (now.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+
+CTEST(queue, mpmc_wake_test){
+	q_mpmc_t *q = q_mpmc_init(int, 16);
+	pthread_t other;
+	struct timespec start;
+	int i, v;
+
+	/* Blocked for good until another thread enqueues */
+	ASSERT_EQUAL(0, pthread_create(&other, NULL, mpmc_late_enq, q));
+	ASSERT_TRUE(q_mpmc_deq_wait(q, &v, -1));
+	ASSERT_EQUAL(42, v);
+	ASSERT_EQUAL(0, pthread_join(other, NULL));
+
+	/* A two second wait returns as soon as the element arrives */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	ASSERT_EQUAL(0, pthread_create(&other, NULL, mpmc_late_enq, q));
+	ASSERT_TRUE(q_mpmc_deq_wait(q, &v, 2000000000L));
+	ASSERT_EQUAL(42, v);
+	ASSERT_TRUE(since(&start) < 1.0);
+	ASSERT_EQUAL(0, pthread_join(other, NULL));
+
+	/* A producer blocked on a full queue is woken by a dequeue */
+	for(i = 0; i < 16; i++)
+		ASSERT_TRUE(q_mpmc_try_enq(q, &i));
+
+	ASSERT_EQUAL(0, pthread_create(&other, NULL, mpmc_late_deq, q));
+	ASSERT_TRUE(q_mpmc_enq_wait(q, &i, -1));
+	ASSERT_EQUAL(0, pthread_join(other, NULL));
+	ASSERT_EQUAL(16, q_mpmc_size(q));
+
+	q_mpmc_free(q);
+}
@@ -0,0 +1,142 @@
+/**
+ * libdstructs: a simple, generic data structures library written in ANSI C.
+ *
+ * Copyright (C) 2013, 2014 Evan Bezeredi <bezeredi.dev@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see {http://www.gnu.org/licenses/}.
+ **/
+#include <stdlib.h>
+#include <stddef.h>
+#include "ctest.h"
+#include "dstructs.h"
+
+
+CTEST(stack, inline_test){
+	stack_t *s = s_init_inline(int);
+	int i, out;
+
+	/* Elements are copied in, so one variable serves every push */
+	for(i = 0; i < 10; i++)
+		s_push(s, &i);
+
+	ASSERT_TRUE(s_pop_into(s, &out));
+	ASSERT_EQUAL(9, out);
+	ASSERT_EQUAL(8, *(int*) s_top(s));
+	ASSERT_EQUAL(9, s_size(s));
+
+	s_free(s);
+}
+
+
+CTEST(stack, array_inline_test){
+	stack_t *arr = s_init_array_inline(int, 2);
+	stack_t *seg = s_init_segmented_inline(int, 4);
+	void **order;
+	int i, out;
+
+	for(i = 0; i < 100; i++) {
+		s_push(arr, &i);
+		s_push(seg, &i);
+	}
+
+	ASSERT_EQUAL(100, s_size(arr));
+	ASSERT_EQUAL(99, *(int*) s_top(seg));
+
+	/* Cross chunk boundaries both ways */
+	for(i = 99; i >= 50; i--) {
+		ASSERT_TRUE(s_pop_into(seg, &out));
+		ASSERT_EQUAL(i, out);
+		ASSERT_EQUAL(i, *(int*) s_pop(arr));
+	}
+
+	for(i = 50; i < 60; i++) s_push(seg, &i);
+
+	order = s_toarr(seg);
+	ASSERT_EQUAL(59, *(int*) order[0]);
+	ASSERT_EQUAL(0, *(int*) order[59]);
+	free(order);
+
+	ASSERT_EQUAL(60, s_size(seg));
+	ASSERT_EQUAL(49, *(int*) s_top(arr));
+
+	s_free(arr);
+	s_free(seg);
+}
+
+
+CTEST(stack, array_pointer_test){
+	stack_t *arr = s_init_array(int, 2);
+	stack_t *seg = s_init_segmented(int, 4);
+	int *elem;
+	int i;
+
+	/* Each stack owns its own copies; s_free(...) frees those left */
+	for(i = 0; i < 30; i++) {
+		elem = malloc(sizeof(int));
+		*elem = i;
+		s_push(arr, elem);
+
+		elem = malloc(sizeof(int));
+		*elem = i;
+		s_push(seg, elem);
+	}
+
+	s_push(seg, NULL);
+	ASSERT_EQUAL(30, s_size(seg));
+
+	for(i = 29; i >= 20; i--) {
+		elem = s_pop(seg);
+		ASSERT_EQUAL(i, *elem);
+		free(elem);
+
+		elem = s_pop(arr);
+		ASSERT_EQUAL(i, *elem);
+		free(elem);
+	}
+
+	ASSERT_EQUAL(19, *(int*) s_top(seg));
+	ASSERT_EQUAL(20, s_size(arr));
+
+	s_free(arr);
+	s_free(seg);
+}
+
+
+/* Alignment of a long double, as the offset that follows a char */
+struct ld_align {
+	char c;
+	long double d;
+};
+
+CTEST(stack, array_align_test){
+	stack_t *arr = s_init_array_inline(long double, 2);
+	stack_t *seg = s_init_segmented_inline(long double, 3);
+	size_t align = offsetof(struct ld_align, d);
+	long double x;
+	int i;
+
+	/* Elements held in place are aligned as malloc(...) would align them */
+	for(i = 0; i < 10; i++) {
+		x = i / 4.0L;
+		s_push(arr, &x);
+		s_push(seg, &x);
+
+		ASSERT_EQUAL(0, (size_t) s_top(arr) % align);
+		ASSERT_EQUAL(0, (size_t) s_top(seg) % align);
+		ASSERT_TRUE(*(long double*) s_top(seg) == x);
+	}
+
+	s_free(arr);
+	s_free(seg);
+}
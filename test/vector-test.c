@@ -0,0 +1,295 @@
+/**
+ * libdstructs: a simple, generic data structures library written in ANSI C.
+ *
+ * Copyright (C) 2013, 2014 Evan Bezeredi <bezeredi.dev@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see {http://www.gnu.org/licenses/}.
+ **/
+#include <string.h>
+#include "ctest.h"
+#include "dstructs.h"
+
+CTEST_DATA(inlinevect){
+	vect_t *v;
+};
+
+CTEST_SETUP(inlinevect){
+	int i;
+
+	data->v = v_init_inline(int);
+
+	for(i = 0; i < 100; i++)
+		v_addl(data->v, &i);
+}
+
+CTEST_TEARDOWN(inlinevect){
+	v_free(data->v);
+}
+
+CTEST2(inlinevect, contiguous_test){
+	int *elems = v_data(data->v);
+
+	ASSERT_EQUAL(100, v_size(data->v));
+	ASSERT_EQUAL(42, elems[42]);
+	ASSERT_EQUAL(99, *(int*) v_last(data->v));
+}
+
+CTEST2(inlinevect, rem_test){
+	int n = 50;
+
+	ASSERT_EQUAL(50, *(int*) v_rem(data->v, 50));
+	ASSERT_EQUAL(51, *(int*) v_get(data->v, 50));
+	ASSERT_EQUAL(-1, v_indexof(data->v, &n));
+	ASSERT_EQUAL(99, v_size(data->v));
+}
+
+CTEST(inlinevect, widths_test){
+	vect_t *bytes = v_init_inline(char);
+	vect_t *pairs = v_init_inline(double[2]);
+	double pair[2];
+	char c;
+	int i;
+
+	for(i = 0; i < 200; i++) {
+		c = (char) i;
+		pair[0] = i;
+		pair[1] = -i;
+		v_addl(bytes, &c);
+		v_addl(pairs, pair);
+	}
+
+	c = (char) 150;
+	pair[0] = 150;
+	pair[1] = 150;
+	ASSERT_EQUAL(150, v_indexof(bytes, &c));
+	ASSERT_FALSE(v_contains(pairs, pair));
+
+	pair[1] = -150;
+	ASSERT_EQUAL(150, v_indexof(pairs, pair));
+
+	v_free(bytes);
+	v_free(pairs);
+}
+
+/* Element i of width w: i + 1 in the low byte(s), 0x5A in the final byte */
+static void scan_elem(unsigned char *elem, size_t w, int i){
+	memset(elem, 0, w);
+	elem[0] = (unsigned char) (i + 1);
+	elem[1] = (unsigned char) ((i + 1) >> 8);
+	elem[w - 1] = 0x5A;
+}
+
+/* Compares every kernel with the expected answer for each element */
+static int scan_mismatches(vect_t *v, size_t w, int n){
+	static const int levels[4] = {V_SCAN_SCALAR, V_SCAN_SSE2, V_SCAN_AVX2,
+	                              V_SCAN_AVX512};
+	unsigned char elem[8];
+	int i, k, bad = 0;
+
+	for(k = 0; k < 4; k++) {
+		if(!__v_scan_force(levels[k])) continue;
+
+		for(i = 0; i < n; i++) {
+			scan_elem(elem, w, i);
+			bad += (v_indexof(v, elem) != i);
+
+			/* Differs only in the final byte */
+			elem[w - 1] = 0xA5;
+			bad += (v_indexof(v, elem) != -1);
+		}
+	}
+
+	__v_scan_force(V_SCAN_AUTO);
+	return bad;
+}
+
+CTEST(inlinevect, kernels_test){
+	static const int lengths[8] = {1, 3, 7, 15, 17, 33, 63, 129};
+	unsigned char elem[8];
+	size_t w;
+	vect_t *v;
+	int i, j;
+
+	ASSERT_TRUE(__v_scan_force(V_SCAN_SCALAR));
+
+	/* Lengths that leave a tail after the widest register */
+	for(w = 2; w <= 8; w *= 2) {
+		for(j = 0; j < 8; j++) {
+			v = __v_init_inline(w);
+
+			for(i = 0; i < lengths[j]; i++) {
+				scan_elem(elem, w, i);
+				v_addl(v, elem);
+			}
+
+			ASSERT_EQUAL(0, scan_mismatches(v, w, lengths[j]));
+			v_free(v);
+		}
+
+		/* Wrapped ring: the 60 elements run past the last of 128 slots */
+		v = __v_init_ring(w, 1);
+		memset(elem, 0x33, w);
+
+		for(i = 0; i < 100; i++) v_addl(v, elem);
+		for(i = 0; i < 100; i++) v_remf(v);
+
+		for(i = 0; i < 60; i++) {
+			scan_elem(elem, w, i);
+			v_addl(v, elem);
+		}
+
+		ASSERT_EQUAL(128, v_cap(v));
+		ASSERT_EQUAL(0, scan_mismatches(v, w, 60));
+		v_free(v);
+	}
+}
+
+CTEST2(inlinevect, range_test){
+	int run[5] = {-1, -2, -3, -4, -5};
+
+	ASSERT_TRUE(v_addall(data->v, 10, run, 5));
+	ASSERT_EQUAL(105, v_size(data->v));
+	ASSERT_EQUAL(-3, *(int*) v_get(data->v, 12));
+	ASSERT_EQUAL(10, *(int*) v_get(data->v, 15));
+
+	ASSERT_EQUAL(5, v_rem_range(data->v, 10, 15, NULL));
+	ASSERT_EQUAL(100, v_size(data->v));
+	ASSERT_EQUAL(10, *(int*) v_get(data->v, 10));
+}
+
+CTEST(ringvect, fifo_test){
+	vect_t *v = v_init_ring_inline(int);
+	int i;
+
+	for(i = 0; i < 1000; i++) {
+		v_addl(v, &i);
+
+		if(i % 2)
+			ASSERT_EQUAL(i / 2, *(int*) v_remf(v));
+	}
+
+	ASSERT_EQUAL(500, v_size(v));
+	ASSERT_EQUAL(500, *(int*) v_first(v));
+	ASSERT_EQUAL(999, *(int*) v_get(v, 499));
+
+	i = -1;
+	v_addf(v, &i);
+	ASSERT_EQUAL(-1, *(int*) v_first(v));
+	i = 600;
+	ASSERT_EQUAL(101, v_indexof(v, &i));
+
+	v_free(v);
+}
+
+CTEST2(inlinevect, foreach_test){
+	v_cur_t cur;
+	int *elem;
+	int sum = 0;
+
+	v_foreach(data->v, elem, cur)
+		sum += *elem;
+
+	ASSERT_EQUAL(4950, sum);
+	ASSERT_EQUAL(99, *(int*) vc_prev(&cur));
+}
+
+CTEST2(inlinevect, sort_test){
+	int copy[100];
+	int n = 42;
+
+	memcpy(copy, v_data(data->v), sizeof(copy));
+	ASSERT_TRUE(v_addall(data->v, 0, copy, 100));
+	ASSERT_TRUE(v_sort(data->v, V_CMP_INT));
+	ASSERT_EQUAL(42, *(int*) v_get(data->v, 85));
+	ASSERT_EQUAL(84, v_bsearch(data->v, &n, V_CMP_INT));
+
+	n = 1000;
+	ASSERT_EQUAL(-201, v_bsearch(data->v, &n, V_CMP_INT));
+
+	ASSERT_TRUE(v_keepsorted(data->v, V_CMP_INT));
+	n = -7;
+	v_addl(data->v, &n);
+	ASSERT_EQUAL(-7, *(int*) v_first(data->v));
+	ASSERT_EQUAL(0, v_indexof(data->v, &n));
+}
+
+CTEST(sortedvect, addall_test){
+	vect_t *v = v_init(int);
+	int vals[20], *ptrs[20];
+	int i;
+
+	for(i = 0; i < 20; i++) {
+		vals[i] = 20 - i;
+		ptrs[i] = &vals[i];
+	}
+
+	ASSERT_TRUE(v_keepsorted(v, V_CMP_INT));
+	ASSERT_TRUE(v_addall(v, 0, ptrs, 3));
+	ASSERT_TRUE(v_addall(v, 0, ptrs + 3, 17));
+	ASSERT_EQUAL(1, *(int*) v_first(v));
+	ASSERT_EQUAL(20, *(int*) v_last(v));
+
+	/* A missing element rejects the whole run */
+	ptrs[10] = NULL;
+	ASSERT_FALSE(v_addall(v, 0, ptrs, 20));
+	ASSERT_FALSE(v_addall(v, 0, ptrs + 8, 4));
+	ASSERT_EQUAL(20, v_size(v));
+
+	/* Searching with an ordering leaves the vector's own in place */
+	i = 5;
+	ASSERT_EQUAL(4, v_bsearch(v, &i, V_CMP_UINT));
+	i = -1;
+	v_addl(v, &i);
+	ASSERT_EQUAL(-1, *(int*) v_first(v));
+	ASSERT_EQUAL(0, v_indexof(v, &i));
+
+	while(v_size(v)) v_remf(v);
+	v_free(v);
+}
+
+static int odd(void* const elem, void* ctx){
+	return *(int*) elem % 2;
+}
+
+CTEST2(inlinevect, remove_if_test){
+	ASSERT_EQUAL(50, v_remove_if(data->v, odd, NULL, NULL));
+	ASSERT_EQUAL(50, v_size(data->v));
+	ASSERT_EQUAL(98, *(int*) v_last(data->v));
+	ASSERT_EQUAL(50, v_retain(data->v, odd, NULL, NULL));
+	ASSERT_TRUE(v_empty(data->v));
+}
+
+CTEST(mmapvect, reopen_test){
+	const char *path = "dstructs-test.vec";
+	vect_t *v;
+	long i;
+
+	v = v_mmap_open(path, long, V_MMAP_CREATE | V_MMAP_TRUNC);
+	ASSERT_NOT_NULL(v);
+
+	for(i = 0; i < 1000; i++)
+		v_addl(v, &i);
+
+	ASSERT_TRUE(v_sync(v));
+	v_free(v);
+
+	v = v_mmap_open(path, long, 0);
+	ASSERT_NOT_NULL(v);
+	ASSERT_EQUAL(1000, v_size(v));
+	ASSERT_EQUAL(999, *(long*) v_last(v));
+	v_free(v);
+
+	ASSERT_NULL(v_mmap_open(path, int, 0));
+	unlink(path);
+}